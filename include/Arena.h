@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The memory resource that distributions created on this thread allocate
+// from. Defaults to the global heap.
+inline std::pmr::memory_resource*& CurrentDistResource()
+{
+    thread_local std::pmr::memory_resource* Resource =
+        std::pmr::new_delete_resource();
+    return Resource;
+}
+
+// Allocates from the thread's current resource at the time the container was
+// created. Like `std::pmr::polymorphic_allocator<>` the resource stays with
+// the container: assigning between containers using different resources
+// copies or moves the elements instead of the buffer.
+template<typename T> struct TDistAllocator
+{
+    using value_type = T;
+
+    TDistAllocator() noexcept : Resource(CurrentDistResource()) {}
+
+    template<typename U>
+    TDistAllocator(const TDistAllocator<U>& Other) noexcept
+        : Resource(Other.Resource)
+    {
+    }
+
+    T* allocate(std::size_t Count)
+    {
+        return static_cast<T*>(
+            Resource->allocate(Count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* Pointer, std::size_t Count) noexcept
+    {
+        Resource->deallocate(Pointer, Count * sizeof(T), alignof(T));
+    }
+
+    // Copies allocate from the heap, never from an arena that happens to be
+    // current, so a copy kept anywhere outlives `FArenaScope::Release()`.
+    TDistAllocator select_on_container_copy_construction() const
+    {
+        return TDistAllocator(std::pmr::new_delete_resource());
+    }
+
+    explicit TDistAllocator(std::pmr::memory_resource* InResource) noexcept
+        : Resource(InResource)
+    {
+    }
+
+    template<typename U>
+    friend bool operator==(const TDistAllocator& A, const TDistAllocator<U>& B)
+    {
+        return A.Resource == B.Resource;
+    }
+
+    std::pmr::memory_resource* Resource;
+};
+
+template<typename T>
+using TDistVector = std::vector<T, TDistAllocator<T>>;
+
+// Makes `Resource` the current resource for this thread while alive.
+class FDistResourceScope
+{
+public:
+    explicit FDistResourceScope(std::pmr::memory_resource* Resource)
+        : Previous(CurrentDistResource())
+    {
+        CurrentDistResource() = Resource;
+    }
+
+    ~FDistResourceScope() { CurrentDistResource() = Previous; }
+
+    FDistResourceScope(const FDistResourceScope&) = delete;
+    FDistResourceScope& operator=(const FDistResourceScope&) = delete;
+
+private:
+    std::pmr::memory_resource* Previous;
+};
+
+// Calls `f` with the heap as the current resource. Library loops that run
+// inside an `FArenaScope` wrap user continuations in this, so distributions
+// a continuation builds, and perhaps keeps somewhere like a log, never live
+// in the arena. Only the library's own temporaries do.
+template<typename F> auto OnHeap(const F& f)
+{
+    return [&f](auto&&... Args) -> decltype(auto)
+    {
+        FDistResourceScope Heap(std::pmr::new_delete_resource());
+        return f(std::forward<decltype(Args)>(Args)...);
+    };
+}
+
+// Routes every distribution created on this thread while alive to a monotonic
+// buffer that is freed in one go, either when the scope ends or on
+// `Release()`. Distributions created before the scope keep their own memory,
+// and copies always go to the heap, so the usual pattern is
+//
+//     FArenaScope Arena;
+//     for (int i = 0; i < n; ++i)
+//     {
+//         Arena.Release();
+//         Dist = Dist.AndThen(OnHeap(f));
+//     }
+//
+// where assigning the result to `Dist` moves its atoms out of the arena.
+// Distributions created inside the scope, other than copies, must be
+// destroyed before the memory is released.
+class FArenaScope
+{
+public:
+    explicit FArenaScope(std::size_t InitialBytes = 1 << 16)
+        : Previous(CurrentDistResource()), BufferSize(InitialBytes),
+          Buffer(std::make_unique_for_overwrite<std::byte[]>(InitialBytes))
+    {
+        Arena.emplace(Buffer.get(), BufferSize, &Upstream);
+        CurrentDistResource() = &*Arena;
+    }
+
+    ~FArenaScope() { CurrentDistResource() = Previous; }
+
+    FArenaScope(const FArenaScope&) = delete;
+    FArenaScope& operator=(const FArenaScope&) = delete;
+
+    // Frees everything allocated since the last release. If that overflowed
+    // the buffer it is enlarged to fit, so a loop doing the same amount of
+    // work each step soon stops allocating.
+    void Release()
+    {
+        if (Upstream.Allocated == 0)
+        {
+            Arena->release();
+            return;
+        }
+
+        Arena.reset();
+        BufferSize += Upstream.Allocated;
+        Upstream.Allocated = 0;
+        Buffer = std::make_unique_for_overwrite<std::byte[]>(BufferSize);
+        Arena.emplace(Buffer.get(), BufferSize, &Upstream);
+    }
+
+private:
+    // Heap resource that records how much the arena has had to add to its
+    // buffer.
+    struct FCountingResource : std::pmr::memory_resource
+    {
+        std::size_t Allocated = 0;
+
+        void* do_allocate(std::size_t Bytes, std::size_t Alignment) override
+        {
+            Allocated += Bytes;
+            return std::pmr::new_delete_resource()->allocate(Bytes, Alignment);
+        }
+
+        void do_deallocate(void* Pointer, std::size_t Bytes,
+                           std::size_t Alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(
+                Pointer, Bytes, Alignment);
+        }
+
+        bool do_is_equal(
+            const std::pmr::memory_resource& Other) const noexcept override
+        {
+            return this == &Other;
+        }
+    };
+
+    std::pmr::memory_resource*                         Previous;
+    FCountingResource                                  Upstream;
+    std::size_t                                        BufferSize;
+    std::unique_ptr<std::byte[]>                       Buffer;
+    std::optional<std::pmr::monotonic_buffer_resource> Arena;
+};
@@ -1,20 +1,41 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <numeric>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "Utilities.h"
+#include "Parallel.h"
+#include "Arena.h"
+#include "SmallVector.h"
 #include "Dist.h"
+#include "Lazy.h"
+#include "Intern.h"
+#include "Memo.h"
+#include "Convolve.h"
+#include "DenseDist.h"
+#include "TensorDist.h"
+#include "ProductDist.h"
+#include "ExactProb.h"
+#include "ProbKernels.h"
+#include "SoADist.h"
+#include "OrderStatistics.h"
 #include "MakeDist.h"
 
 template <typename P = double, typename T> TDist<P, T> Certainly(const T& t)
 {
-    return TDist<P, T>{ { t, 1.0 } };
+    return TDist<P, T>{ { t, P(1) } };
 }
 
 template <typename P = double> TDist<P, int> Roll(int n)
@@ -23,20 +44,48 @@ template <typename P = double> TDist<P, int> Roll(int n)
     result.PDF.resize(n);
     for (int i = 0; i < n; ++i)
     {
-        result.PDF[i] = TAtom{ i + 1, 1. / n };
+        result.PDF[i] = TAtom<P, int>{ i + 1, P(1) / n };
     }
 
     return result;
 }
 
-template <typename P = double> TDist<P, int> Roll(int r, int n)
+// Sum of `n` independent copies of `d`, computed by repeated squaring so it
+// takes O(log n) additions. Integer valued distributions add by
+// convolution, which keeps every value with nonzero probability.
+template <typename P, typename T>
+TDist<P, T> SumOf(int n, const TDist<P, T>& d)
 {
-    TDist<P, int> d = Certainly(0);
-    for (int i = 0; i < r; ++i)
+    if (n <= 0)
     {
-        d = d + Roll(n);
+        return Certainly<P>(T{});
     }
-    return d;
+
+    return RepeatedSquaring(n, d, [](const auto& a, const auto& b)
+                            { return a + b; });
+}
+
+template <typename P = double> TDist<P, int> Roll(int r, int n)
+{
+    return SumOf(r, Roll<P>(n));
+}
+
+// Shared copies of `Certainly()` and `Roll()` for use inside continuations.
+// See `Interned()`.
+template <typename P = double, typename T>
+TDistHandle<P, T> InternedCertainly(const T& t)
+{
+    return Interned([](const T& t) { return Certainly<P>(t); }, t);
+}
+
+template <typename P = double> TDistHandle<P, int> InternedRoll(int n)
+{
+    return Interned([](int n) { return Roll<P>(n); }, n);
+}
+
+template <typename P = double> TDistHandle<P, int> InternedRoll(int r, int n)
+{
+    return Interned([](int r, int n) { return Roll<P>(r, n); }, r, n);
 }
 
 // Keeps lowest
@@ -79,29 +128,7 @@ template <typename P, typename X, typename Compare = std::greater<X>>
 TDist<P, std::vector<X>> highest_n(const TDist<P, X>& dst, int Roll, int keep,
                                    Compare compare = std::greater<X>())
 {
-    TDist<P, std::vector<X>> so_far(Certainly(std::vector<X>{}));
-
-    for (int i = 0; i < Roll; ++i)
-    {
-        so_far = so_far.AndThen(
-            [keep, compare, &dst](const std::vector<X>& v)
-            {
-                return dst.Transform(
-                    [v, keep, compare](const X& x)
-                    {
-                        std::vector<X> v_copy = v;
-                        insert_and_keep_sorted(
-                            v_copy,
-                            x,
-                            keep,
-                            compare); //[](const X& a, const X& b) { return a >
-                                      // b; });
-                        return v_copy;
-                    });
-            });
-    }
-
-    return so_far;
+    return KeepHighest(Roll, keep, dst, compare);
 }
 
 #define DO(b) [&]() { b; }();
@@ -163,6 +190,19 @@ TDist<P, T> fold(const F& f, const T& init,
         return Certainly(init);
     }
 
+    // Sums don't need the history of partial results so add the
+    // distributions directly, which convolves integer valued ones.
+    if constexpr (std::is_same_v<F, std::plus<>> ||
+                  std::is_same_v<F, std::plus<T>>)
+    {
+        TDist<P, T> total = dists[starting_from] + init;
+        for (std::size_t i = starting_from + 1; i < dists.size(); ++i)
+        {
+            total = total + dists[i];
+        }
+        return total;
+    }
+
     return DO(LET(const T& head,
                   dists[starting_from],
                   return fold(f, f(init, head), dists, starting_from + 1)));
@@ -180,6 +220,15 @@ namespace cs
         }
     };
 
+    class min
+    {
+    public:
+        template <typename X> X operator()(const X& a, const X& b) const
+        {
+            return b < a ? b : a;
+        }
+    };
+
 } // namespace cs
 
 template <typename P = double, typename T, typename U, typename F>
@@ -190,6 +239,15 @@ TDist<P, T> repeated(const F& f, const T& init, const TDist<P, U>& TDist, int n)
         return Certainly(init);
     }
 
+    if constexpr (std::is_same_v<T, U> && std::is_same_v<F, cs::max>)
+    {
+        return Max(Certainly<P>(init), MaxOf(n, TDist));
+    }
+    else if constexpr (std::is_same_v<T, U> && std::is_same_v<F, cs::min>)
+    {
+        return Min(Certainly<P>(init), MinOf(n, TDist));
+    }
+
     return repeated(f, init, TDist, n - 1) >> [&](int head)
     { return TDist >> [&](int tail) { return Certainly(f(head, tail)); }; };
 }
@@ -199,6 +257,15 @@ TDist<P, T> repeated(const F& f, const T& init, const TDist<P, U>& TDist, int n)
 template <typename P, typename F, typename T>
 TDist<P, T> reduce(int n, const F& f, TDist<P, T>& d)
 {
+    if constexpr (std::is_same_v<F, cs::max>)
+    {
+        return MaxOf(std::max(n, 1), d);
+    }
+    else if constexpr (std::is_same_v<F, cs::min>)
+    {
+        return MinOf(std::max(n, 1), d);
+    }
+
     auto e = d;
     for (int i = 1; i < n; ++i)
     {
@@ -221,25 +288,137 @@ void test2()
 
 void test3()
 {
-    TDist<double, int> r =
-        repeated([](int x, int y) { return std::max(x, y); }, 0, Roll(6), 50);
+    TDist<double, int> r = repeated(cs::max(), 0, Roll(6), 50);
     for (auto z : r.PDF)
     {
         std::cout << z << std::endl;
     }
 }
 
+// Applies `f` `n` times starting from `init`, reducing by the states'
+// symmetry and pruning after each step as `Pruning` asks. The probability
+// pruned is in the result's `Discarded`.
 template <typename P = double, typename X, typename F>
-TDist<P, X> iterate(const X& init, const F& f, int n)
+TDist<P, X> iterate(const X& init, const F& f, int n,
+                    const FPruning& Pruning = FPruning{})
 {
-    TDist<double, X> r = Certainly(init);
+    TDist<P, X> r = Certainly<P>(CanonicalState(init));
+    FArenaScope Arena;
     for (int i = 0; i < n; ++i)
     {
-        r = r >> f;
+        Arena.Release();
+        r = std::move(r) >> OnHeap(f);
+        r.ReduceSymmetry();
+        r.Prune(Pruning);
     }
     return r;
 }
 
+// Splits a distribution into the live states still being expanded and the
+// mass that has settled in absorbing states, for loops where `f` returns
+// `Certainly(State)` once `IsAbsorbing(State)` holds:
+//
+//     TFrontier Frontier(Certainly(init), IsAbsorbing);
+//     for (int i = 0; i < n && !Frontier.Live.PDF.empty(); ++i)
+//     {
+//         Frontier.Step(f);
+//     }
+//     auto Dist = std::move(Frontier).Result();
+//
+// Each step only calls `f` on, sorts and merges the live atoms, so its cost
+// follows the size of the frontier rather than of everything reachable.
+// Settled atoms are appended as they arrive and only canonicalised once
+// they have doubled in number. If the steps run inside an `FArenaScope`,
+// call `Result()` after it ends.
+template <typename P, typename X, typename A> class TFrontier
+{
+public:
+    TFrontier(TDist<P, X> Start, A InIsAbsorbing)
+        : Live(std::move(Start)), IsAbsorbing(std::move(InIsAbsorbing))
+    {
+        Live.ReduceSymmetry();
+        SettleAbsorbed();
+    }
+
+    template <typename F>
+    void Step(const F& f, const FPruning& Pruning = FPruning{})
+    {
+        Step(f, EMergeStrategy::Sort, Pruning);
+    }
+
+    // As above, merging the results of `f` with `Strategy`.
+    template <typename F>
+    void Step(const F& f, EMergeStrategy Strategy,
+              const FPruning& Pruning = FPruning{})
+    {
+        Live = std::move(Live).AndThen(f, Strategy);
+        Live.ReduceSymmetry();
+        Live.Prune(Pruning);
+        SettleAbsorbed();
+    }
+
+    // The live and settled atoms merged back into one distribution.
+    TDist<P, X> Result() &&
+    {
+        Settled.canonicalise();
+        return TDist<P, X>::MergeSorted(std::move(Settled), std::move(Live));
+    }
+
+    TDist<P, X> Live;
+    TDist<P, X> Settled{};
+
+private:
+    void SettleAbsorbed()
+    {
+        auto Out = Live.PDF.begin();
+        for (auto In = Live.PDF.begin(); In != Live.PDF.end(); ++In)
+        {
+            if (IsAbsorbing(In->Value))
+            {
+                Settled.PDF.push_back(std::move(*In));
+            }
+            else
+            {
+                if (Out != In)
+                {
+                    *Out = std::move(*In);
+                }
+                ++Out;
+            }
+        }
+        Live.PDF.erase(Out, Live.PDF.end());
+
+        if (Settled.PDF.size() > 2 * NumCanonical)
+        {
+            Settled.canonicalise();
+            NumCanonical = Settled.PDF.size();
+        }
+    }
+
+    A           IsAbsorbing;
+    std::size_t NumCanonical = 0;
+};
+
+// As above, but states for which `IsAbsorbing` holds are set aside instead of
+// being passed to `f`, which must return `Certainly(State)` for them. Stops
+// early once every state is absorbed.
+template <typename P = double, typename X, typename F, typename A>
+    requires std::predicate<const A&, const X&>
+TDist<P, X> iterate(const X& init, const F& f, int n, const A& IsAbsorbing,
+                    const FPruning& Pruning = FPruning{})
+{
+    TFrontier<P, X, A> Frontier(Certainly<P>(init), IsAbsorbing);
+    {
+        FArenaScope Arena;
+        for (int i = 0; i < n && !Frontier.Live.PDF.empty(); ++i)
+        {
+            Arena.Release();
+            Frontier.Step(OnHeap(f), Pruning);
+        }
+    }
+    return std::move(Frontier).Result();
+}
+
 void test4()
 {
     struct X
@@ -388,27 +567,9 @@ void test6()
 template <typename P = double>
 TDist<P, std::vector<int>> roll_keep(int r, int k)
 {
-    if (r == 0)
-    {
-        return Certainly(std::vector<int>{});
-    }
-    else
-    {
-        return roll_keep(r - 1, k) >> [=](const std::vector<int>& rolls)
-        {
-            return Roll(6) >> [=](int n)
-            {
-                auto new_rolls = rolls;
-                new_rolls.push_back(n);
-                std::sort(new_rolls.begin(), new_rolls.end());
-                if (new_rolls.size() > k)
-                {
-                    new_rolls.resize(k);
-                }
-                return Certainly(new_rolls);
-            };
-        };
-    }
+    // Note that "top" means first in ascending order so this keeps the
+    // lowest rolls.
+    return KeepHighest(r, k, Roll<P>(6), std::less<int>());
 }
 
 namespace cs
@@ -479,19 +640,21 @@ P dot_sparse_dense(const SparseVector<P>& s, const std::vector<P>& d)
 template <typename P>
 std::vector<P> DotMatrixVector(const TMatrix<P>& m, const std::vector<P>& d)
 {
-    std::vector<P> r;
-    r.resize(d.size());
-    for (int i = 0; i < d.size(); ++i)
-    {
-        r[i] = 0.0;
-    }
+    // Each entry sums many small contributions, so compensate for rounding.
+    std::vector<TCompensatedSum<P>> sums(d.size());
     for (int i = 0; i < d.size(); ++i)
     {
         for (auto [j, x] : m[i])
         {
-            r[j] += x * d[i];
+            sums[j].Add(x * d[i]);
         }
     }
+    std::vector<P> r;
+    r.resize(d.size());
+    for (std::size_t i = 0; i < d.size(); ++i)
+    {
+        r[i] = sums[i].Result();
+    }
     return r;
 }
 
@@ -541,11 +704,12 @@ TDist<P, X> convert_to_pdf(setup<P, X>* s, const std::vector<P>& v)
 template <typename P, typename X, typename F>
 setup<P, X>* BuildMatrix(const X& x, const F& f)
 {
+    const X          start = CanonicalState(x);
     std::map<X, int> labels;
     int              next_label = 0;
-    labels[x] = next_label++;
+    labels[start] = next_label++;
     std::vector<X> values_to_process;
-    values_to_process.push_back(x);
+    values_to_process.push_back(start);
     int        next_value_to_process = 0;
     TMatrix<P> m;
 
@@ -553,6 +717,7 @@ setup<P, X>* BuildMatrix(const X& x, const F& f)
     while (next_value_to_process < values_to_process.size())
     {
         TDist<P, X> r = f(values_to_process[next_value_to_process]);
+        r.ReduceSymmetry();
         row.clear();
         for (auto& [Value, Prob] : r.PDF)
         {
@@ -607,13 +772,18 @@ template <typename P> P MinDiagonal(const TMatrix<P>& Matrix)
 }
 
 template <typename P = double, typename X, typename F>
-TDist<P, X> iterate_i(const X& init, const F& f, int n)
+TDist<P, X> iterate_i(const X& init, const F& f, int n,
+                      const FPruning& Pruning = FPruning{})
 {
-    TDist<P, X> r = Certainly(init);
+    TDist<P, X> r = Certainly<P>(CanonicalState(init));
+    FArenaScope Arena;
     for (int i = 0; i < n; ++i)
     {
+        Arena.Release();
         const auto old_r = r;
-        r = old_r >> f;
+        r = old_r >> OnHeap(f);
+        r.ReduceSymmetry();
+        r.Prune(Pruning);
         std::cout << old_r.PDF.size() << '/' << r.PDF.size() << std::endl;
         if (subdist(r, old_r))
         {
@@ -623,6 +793,32 @@ TDist<P, X> iterate_i(const X& init, const F& f, int n)
     return r;
 }
 
+template <typename P = double, typename X, typename F, typename A>
+    requires std::predicate<const A&, const X&>
+TDist<P, X> iterate_i(const X& init, const F& f, int n, const A& IsAbsorbing,
+                      const FPruning& Pruning = FPruning{})
+{
+    TFrontier<P, X, A> Frontier(Certainly<P>(init), IsAbsorbing);
+    {
+        FArenaScope Arena;
+        for (int i = 0; i < n; ++i)
+        {
+            Arena.Release();
+            const std::size_t NumLive = Frontier.Live.PDF.size();
+            Frontier.Step(OnHeap(f), Pruning);
+            std::cout << NumLive << '/' << Frontier.Live.PDF.size()
+                      << " live, " << Frontier.Settled.PDF.size()
+                      << " settled" << std::endl;
+            if (Frontier.Live.PDF.empty())
+            {
+                std::cout << "Absorbed" << std::endl;
+                break;
+            }
+        }
+    }
+    return std::move(Frontier).Result();
+}
+
 template <typename P = double, typename X, typename F>
 TDist<P, X> iterate_matrix_i(const X& init, const F& f, int n)
 {
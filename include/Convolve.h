@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <numbers>
+#include <type_traits>
+#include <vector>
+
+// Convolution of probability arrays, used to add independent integer valued
+// random variables. Small inputs use the direct O(n m) loop and large inputs
+// an O(L log L) FFT where L is the length of the result, unless the FFT's
+// rounding error could swamp some of the result's entries.
+
+// The FFT is used once both inputs have at least this many entries and the
+// direct loop would take more than `ConvolveFFTCostRatio` times as many
+// multiply-adds as the FFT's L log L. Both were chosen by timing
+// `ConvolveDirect()` against `ConvolveFFT()` in `bench`.
+inline constexpr std::size_t ConvolveFFTMinSize = 64;
+inline constexpr double      ConvolveFFTCostRatio = 20.0;
+
+template<typename ProbType>
+std::vector<ProbType> ConvolveDirect(const std::vector<ProbType>& A,
+                                     const std::vector<ProbType>& B)
+{
+    if (A.empty() || B.empty())
+    {
+        return {};
+    }
+
+    // Loop over the longer array innermost so the compiler can vectorise the
+    // multiply-add over a long contiguous run.
+    const std::vector<ProbType>& Outer = A.size() < B.size() ? A : B;
+    const std::vector<ProbType>& Inner = A.size() < B.size() ? B : A;
+
+    std::vector<ProbType> Result(A.size() + B.size() - 1, 0);
+    for (std::size_t I = 0; I < Outer.size(); ++I)
+    {
+        const ProbType  Prob = Outer[I];
+        ProbType*       Target = Result.data() + I;
+        const ProbType* Source = Inner.data();
+        for (std::size_t J = 0; J < Inner.size(); ++J)
+        {
+            Target[J] += Prob * Source[J];
+        }
+    }
+
+    return Result;
+}
+
+// In place iterative radix-2 FFT. `Data.size()` must be a power of two.
+inline void FFT(std::vector<std::complex<double>>& Data, bool bInverse)
+{
+    const std::size_t Size = Data.size();
+
+    for (std::size_t I = 1, J = 0; I < Size; ++I)
+    {
+        std::size_t Bit = Size >> 1;
+        for (; J & Bit; Bit >>= 1)
+        {
+            J ^= Bit;
+        }
+        J ^= Bit;
+        if (I < J)
+        {
+            std::swap(Data[I], Data[J]);
+        }
+    }
+
+    for (std::size_t Length = 2; Length <= Size; Length <<= 1)
+    {
+        const double Angle =
+            2 * std::numbers::pi / Length * (bInverse ? 1 : -1);
+        const std::complex<double> Root(std::cos(Angle), std::sin(Angle));
+        for (std::size_t Start = 0; Start < Size; Start += Length)
+        {
+            std::complex<double> Twiddle(1);
+            for (std::size_t K = 0; K < Length / 2; ++K)
+            {
+                const std::complex<double> Even = Data[Start + K];
+                const std::complex<double> Odd =
+                    Data[Start + K + Length / 2] * Twiddle;
+                Data[Start + K] = Even + Odd;
+                Data[Start + K + Length / 2] = Even - Odd;
+                Twiddle *= Root;
+            }
+        }
+    }
+
+    if (bInverse)
+    {
+        for (auto& Element : Data)
+        {
+            Element /= static_cast<double>(Size);
+        }
+    }
+}
+
+// Absolute error of `ConvolveFFT()` on a transform of `Size` entries whose
+// largest result is `Peak`.
+inline double FFTNoiseFloor(std::size_t Size, double Peak)
+{
+    return 8 * std::numeric_limits<double>::epsilon() *
+           std::log2(static_cast<double>(Size)) * Peak;
+}
+
+// FFT convolution. The result carries an absolute error of
+// `FFTNoiseFloor()`, so entries below that level, including spurious
+// negative ones, are flushed to zero. Only exact when every nonzero entry of
+// the true result is well above the floor. `Convolve()` checks this with
+// `IsWithinFFTRange()`.
+template<typename ProbType>
+std::vector<ProbType> ConvolveFFT(const std::vector<ProbType>& A,
+                                  const std::vector<ProbType>& B)
+{
+    if (A.empty() || B.empty())
+    {
+        return {};
+    }
+
+    const std::size_t ResultSize = A.size() + B.size() - 1;
+    std::size_t       Size = 1;
+    while (Size < ResultSize)
+    {
+        Size <<= 1;
+    }
+
+    // Pack `A` into the real part and `B` into the imaginary part so one
+    // forward transform does the work of two.
+    std::vector<std::complex<double>> Packed(Size);
+    for (std::size_t I = 0; I < A.size(); ++I)
+    {
+        Packed[I].real(static_cast<double>(A[I]));
+    }
+    for (std::size_t I = 0; I < B.size(); ++I)
+    {
+        Packed[I].imag(static_cast<double>(B[I]));
+    }
+    FFT(Packed, false);
+
+    // With P = FFT(a + ib), FFT(a) FFT(b) = (P[k]^2 - conj(P[-k])^2) / 4i.
+    std::vector<std::complex<double>> Product(Size);
+    for (std::size_t K = 0; K < Size; ++K)
+    {
+        const std::complex<double> Forward = Packed[K];
+        const std::complex<double> Backward =
+            std::conj(Packed[(Size - K) & (Size - 1)]);
+        Product[K] = (Forward * Forward - Backward * Backward) *
+                     std::complex<double>(0, -0.25);
+    }
+    FFT(Product, true);
+
+    double Peak = 0;
+    for (std::size_t I = 0; I < ResultSize; ++I)
+    {
+        Peak = std::max(Peak, Product[I].real());
+    }
+    const double Noise = FFTNoiseFloor(Size, Peak);
+
+    std::vector<ProbType> Result(ResultSize);
+    for (std::size_t I = 0; I < ResultSize; ++I)
+    {
+        const double Value = Product[I].real();
+        Result[I] = Value > Noise ? static_cast<ProbType>(Value) : ProbType(0);
+    }
+
+    return Result;
+}
+
+template<typename ProbType>
+bool ShouldConvolveWithFFT(std::size_t SizeA, std::size_t SizeB)
+{
+    if (!std::is_floating_point_v<ProbType> ||
+        std::min(SizeA, SizeB) < ConvolveFFTMinSize)
+    {
+        return false;
+    }
+
+    const double Length = static_cast<double>(SizeA + SizeB - 1);
+    return static_cast<double>(SizeA) * static_cast<double>(SizeB) >
+           ConvolveFFTCostRatio * Length * std::log2(Length);
+}
+
+// Whether every nonzero entry of the convolution of `A` and `B` is sure to
+// stay above `ConvolveFFT()`'s noise floor, so the FFT loses no support.
+// Each such entry is at least the product of the smallest nonzero inputs,
+// and no entry exceeds the largest of one input times the total of the
+// other. Distributions with long thin tails, like a geometric one or the
+// sum of many dice, fail this and are convolved directly.
+template<typename ProbType>
+bool IsWithinFFTRange(const std::vector<ProbType>& A, const std::vector<ProbType>& B)
+{
+    struct FRange
+    {
+        double Smallest = std::numeric_limits<double>::infinity();
+        double Largest = 0;
+        double Total = 0;
+    };
+    auto RangeOf = [](const std::vector<ProbType>& Probs)
+    {
+        FRange Range;
+        for (const ProbType& Prob : Probs)
+        {
+            const double Value = static_cast<double>(Prob);
+            if (Value > 0)
+            {
+                Range.Smallest = std::min(Range.Smallest, Value);
+                Range.Largest = std::max(Range.Largest, Value);
+                Range.Total += Value;
+            }
+        }
+        return Range;
+    };
+
+    const FRange      RangeA = RangeOf(A);
+    const FRange      RangeB = RangeOf(B);
+    const std::size_t Size = std::bit_ceil(A.size() + B.size() - 1);
+    const double      Peak = std::min(RangeA.Largest * RangeB.Total,
+                                      RangeB.Largest * RangeA.Total);
+
+    // Twice the floor, since the computed entry may itself be low by that much.
+    return RangeA.Smallest * RangeB.Smallest > 2 * FFTNoiseFloor(Size, Peak);
+}
+
+template<typename ProbType>
+std::vector<ProbType> Convolve(const std::vector<ProbType>& A,
+                               const std::vector<ProbType>& B)
+{
+    if constexpr (std::is_floating_point_v<ProbType>)
+    {
+        if (ShouldConvolveWithFFT<ProbType>(A.size(), B.size()) &&
+            IsWithinFFTRange(A, B))
+        {
+            return ConvolveFFT(A, B);
+        }
+    }
+
+    return ConvolveDirect(A, B);
+}
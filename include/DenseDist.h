@@ -0,0 +1,359 @@
+#pragma once
+
+#include <stdexcept>
+
+// A distribution over a contiguous range of integers stored as the smallest
+// value in the range and an array of probabilities, one per value. Sums,
+// shifts and continuations run as loops over the array with no sorting.
+// Continuations and transforms return a `TDist<>`, since their results need
+// not be compact, and so do sums with a `TDist<>`. Converts implicitly to and
+// from `TDist<>`.
+template<typename ProbType, typename ValueType> struct TDenseDist
+{
+    static_assert(CDenseValue<ValueType>);
+
+    TDenseDist() : Min(0) {}
+
+    TDenseDist(ValueType InMin, std::vector<ProbType> InProbs)
+        : Min(InMin), Probs(std::move(InProbs))
+    {
+    }
+
+    // Only compact distributions fit in an array, so any other throws
+    // `std::length_error` rather than allocating one entry per value in the
+    // range.
+    TDenseDist(const TDist<ProbType, ValueType>& Dist) : Min(0)
+    {
+        if (!Dist.PDF.empty() && !Dist.HasCompactSupport())
+        {
+            throw std::length_error(
+                "TDenseDist: support is too sparse to store densely");
+        }
+        Add(Dist, ProbType(1));
+    }
+
+    operator TDist<ProbType, ValueType>() const
+    {
+        TDist<ProbType, ValueType> result{};
+        for (std::size_t I = 0; I < Probs.size(); ++I)
+        {
+            if (Probs[I] != 0)
+            {
+                result.PDF.push_back(
+                    TAtom<ProbType, ValueType>{ ValueAt(I), Probs[I] });
+            }
+        }
+
+        return result;
+    }
+
+    TDist<ProbType, ValueType> ToDist() const { return *this; }
+
+    ValueType ValueAt(std::size_t Index) const
+    {
+        return static_cast<ValueType>(Min + static_cast<ValueType>(Index));
+    }
+
+    // Adds `Scale` times `Other` to this distribution, growing the range as
+    // needed.
+    void Add(const TDenseDist& Other, ProbType Scale)
+    {
+        if (Other.Probs.empty())
+        {
+            return;
+        }
+        Reserve(Other.Min, Other.ValueAt(Other.Probs.size() - 1));
+
+        ProbType* Target = Probs.data() + Distance(Min, Other.Min);
+        for (std::size_t I = 0; I < Other.Probs.size(); ++I)
+        {
+            Target[I] += Scale * Other.Probs[I];
+        }
+    }
+
+    void Add(const TDist<ProbType, ValueType>& Other, ProbType Scale)
+    {
+        if (Other.PDF.empty())
+        {
+            return;
+        }
+        auto [Lowest, Highest] = std::minmax_element(Other.PDF.begin(),
+                                                     Other.PDF.end());
+        Reserve(Lowest->Value, Highest->Value);
+
+        for (const auto& [Value, Prob] : Other.PDF)
+        {
+            Probs[Distance(Min, Value)] += Scale * Prob;
+        }
+    }
+
+    // Continuations and transforms can spread values arbitrarily far apart,
+    // so both return a `TDist<>`. When the results span a compact range
+    // they are summed into an array here, and otherwise they go through
+    // the sorting path.
+    template<typename F> auto AndThen(const F& f) const
+    {
+        using ResultType = std::invoke_result_t<F, ValueType>;
+        using ResultProbType = typename TDistTypes<ResultType>::Prob;
+        using ResultValueType = typename TDistTypes<ResultType>::Value;
+
+        if constexpr (CDenseValue<ResultValueType>)
+        {
+            using ResultDistType = TDist<ResultProbType, ResultValueType>;
+
+            std::vector<ResultDistType> Results(Probs.size(), ResultDistType{});
+            bool                        bEmpty = true;
+            ResultValueType             Lowest{};
+            ResultValueType             Highest{};
+            std::size_t                 NumAtoms = 0;
+            ResultProbType              Discarded = 0;
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    Results[I] = f(ValueAt(I));
+                    for (const auto& [Value, Prob] : Results[I].PDF)
+                    {
+                        Lowest = bEmpty ? Value : std::min(Lowest, Value);
+                        Highest = bEmpty ? Value : std::max(Highest, Value);
+                        bEmpty = false;
+                    }
+                    NumAtoms += Results[I].PDF.size();
+                    Discarded += Probs[I] * Results[I].Discarded;
+                }
+            }
+
+            ResultDistType result{};
+            if (!bEmpty)
+            {
+                if (ResultDistType::IsCompactSpan(Lowest, Highest, NumAtoms))
+                {
+                    TDenseDist<ResultProbType, ResultValueType> Dense;
+                    Dense.Reserve(Lowest, Highest);
+                    for (std::size_t I = 0; I < Probs.size(); ++I)
+                    {
+                        for (const auto& [Value, Prob] : Results[I].PDF)
+                        {
+                            Dense.Probs[Dense.Distance(Lowest, Value)] +=
+                                Probs[I] * Prob;
+                        }
+                    }
+                    result = Dense.ToDist();
+                }
+                else
+                {
+                    for (std::size_t I = 0; I < Probs.size(); ++I)
+                    {
+                        for (const auto& [Value, Prob] : Results[I].PDF)
+                        {
+                            result.PDF.push_back(TAtom<ResultProbType, ResultValueType>{
+                                Value, Probs[I] * Prob });
+                        }
+                    }
+                    result.canonicalise();
+                }
+            }
+            result.Discarded = Discarded;
+
+            return result;
+        }
+        else
+        {
+            return ToDist().AndThen(f);
+        }
+    }
+
+    template<typename F> auto Transform(const F& f) const
+    {
+        using ResultValueType = std::invoke_result_t<F, ValueType>;
+
+        if constexpr (CDenseValue<ResultValueType>)
+        {
+            using ResultDistType = TDist<ProbType, ResultValueType>;
+
+            // Evaluate `f` first so the range of the result is known before
+            // scattering into it.
+            std::vector<ResultValueType> Values(Probs.size());
+            bool                         bEmpty = true;
+            ResultValueType              Lowest{};
+            ResultValueType              Highest{};
+            std::size_t                  NumAtoms = 0;
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    Values[I] = f(ValueAt(I));
+                    Lowest = bEmpty ? Values[I] : std::min(Lowest, Values[I]);
+                    Highest = bEmpty ? Values[I] : std::max(Highest, Values[I]);
+                    bEmpty = false;
+                    ++NumAtoms;
+                }
+            }
+
+            ResultDistType result{};
+            if (bEmpty)
+            {
+                return result;
+            }
+
+            if (ResultDistType::IsCompactSpan(Lowest, Highest, NumAtoms))
+            {
+                TDenseDist<ProbType, ResultValueType> Dense;
+                Dense.Reserve(Lowest, Highest);
+                for (std::size_t I = 0; I < Probs.size(); ++I)
+                {
+                    if (Probs[I] != 0)
+                    {
+                        Dense.Probs[Dense.Distance(Lowest, Values[I])] +=
+                            Probs[I];
+                    }
+                }
+                return Dense.ToDist();
+            }
+
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    result.PDF.push_back(
+                        TAtom<ProbType, ResultValueType>{ Values[I], Probs[I] });
+                }
+            }
+            result.canonicalise();
+
+            return result;
+        }
+        else
+        {
+            return ToDist().Transform(f);
+        }
+    }
+
+    TDenseDist operator+(const TDenseDist& Other) const
+    {
+        if (Probs.empty() || Other.Probs.empty())
+        {
+            return TDenseDist{};
+        }
+
+        std::vector<ProbType> Sum = Convolve(Probs, Other.Probs);
+
+        return TDenseDist(static_cast<ValueType>(Min + Other.Min),
+                          std::move(Sum));
+    }
+
+    // Not a template so it is preferred over the generic `TDist<>` operators
+    // when mixing the two representations. Sparse operands go through the
+    // sorting sum instead of being spread over an array.
+    TDist<ProbType, ValueType>
+    operator+(const TDist<ProbType, ValueType>& Other) const
+    {
+        if (Other.PDF.empty() || !Other.HasCompactSupport())
+        {
+            return ToDist() + Other;
+        }
+
+        TDist<ProbType, ValueType> result = *this + TDenseDist(Other);
+        result.Discarded = Other.Discarded;
+        return result;
+    }
+
+    TDenseDist operator+(const ValueType& Other) const
+    {
+        return TDenseDist(static_cast<ValueType>(Min + Other), Probs);
+    }
+
+    TDist<ProbType, bool> operator<=(const ValueType& Other) const
+    {
+        return Transform([&Other](ValueType x) { return x <= Other; });
+    }
+
+    TDist<ProbType, bool> operator>=(const ValueType& Other) const
+    {
+        return Transform([&Other](ValueType x) { return x >= Other; });
+    }
+
+    void check() const
+    {
+        double total = 0.0;
+
+        for (const auto& Prob : Probs)
+        {
+            total += Prob;
+        }
+
+        std::cout << "total = " << total << std::endl;
+    }
+
+    void dump() const
+    {
+        for (std::size_t I = 0; I < Probs.size(); ++I)
+        {
+            if (Probs[I] != 0)
+            {
+                std::cout << ValueAt(I) << ": " << Probs[I] << std::endl;
+            }
+        }
+    }
+
+    // Grows the range to include `[Lowest, Highest]`.
+    void Reserve(ValueType Lowest, ValueType Highest)
+    {
+        if (Probs.empty())
+        {
+            Min = Lowest;
+            Probs.assign(Distance(Lowest, Highest) + 1, 0);
+            return;
+        }
+
+        if (Lowest < Min)
+        {
+            Probs.insert(Probs.begin(), Distance(Lowest, Min), 0);
+            Min = Lowest;
+        }
+        if (Distance(Min, Highest) >= Probs.size())
+        {
+            Probs.resize(Distance(Min, Highest) + 1, 0);
+        }
+    }
+
+    // `To - From` for `From <= To`, computed in 64 bits so ranges wider than
+    // `ValueType` can count don't overflow.
+    static std::size_t Distance(ValueType From, ValueType To)
+    {
+        return static_cast<std::size_t>(static_cast<unsigned long long>(To) -
+                                        static_cast<unsigned long long>(From));
+    }
+
+    ValueType             Min;
+    std::vector<ProbType> Probs;
+};
+
+template<typename ProbType, typename ValueType>
+struct TDistTypes<TDenseDist<ProbType, ValueType>>
+{
+    using Prob = ProbType;
+    using Value = ValueType;
+};
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType>
+operator+(const TDist<ProbType, ValueType>& Dist,
+          const TDenseDist<ProbType, ValueType>& Dense)
+{
+    return Dense + Dist;
+}
+
+template<typename ProbType, typename ValueType>
+TDenseDist<ProbType, ValueType>
+operator+(const ValueType& t, const TDenseDist<ProbType, ValueType>& Dense)
+{
+    return Dense + t;
+}
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType>
+operator*(const ValueType& t, const TDenseDist<ProbType, ValueType>& Dense)
+{
+    return Dense.Transform([t](ValueType x) { return t * x; });
+}
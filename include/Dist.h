@@ -10,6 +10,419 @@ template<typename ProbType, typename ValueType> struct TAtom
 
 template<typename ProbType, typename ValueType> struct TDist;
 
+// Integer value types that can be stored densely by `TDenseDist<>`.
+template<typename ValueType>
+concept CDenseValue =
+    std::integral<ValueType> && !std::same_as<ValueType, bool>;
+
+template<typename ProbType, typename ValueType> struct TDenseDist;
+
+template<typename ProbType, typename ValueType, typename EmitterType>
+class TLazyDist;
+
+// Extracts the probability and value types from a `TDist<>` type.
+template<typename DistType> struct TDistTypes;
+
+template<typename ProbType, typename ValueType>
+struct TDistTypes<TDist<ProbType, ValueType>>
+{
+    using Prob = ProbType;
+    using Value = ValueType;
+};
+
+// How `AndThen()` and `Transform()` combine atoms that end up with the same
+// value.
+enum class EMergeStrategy
+{
+    // Collect every atom, then sort and merge.
+    Sort,
+    // Merge duplicates as they are produced using a hash table and sort only
+    // the distinct values at the end. Peak memory tracks the size of the
+    // result rather than the fan-out. Falls back to `Sort` for value types
+    // without a `TValueHash<>`.
+    Hash,
+    // `AndThen()` only. Treats each distribution returned by the continuation
+    // as a sorted run and combines the runs with a heap based k-way merge,
+    // summing equal values as they meet. Costs O(N log k) for N atoms in k
+    // runs instead of O(N log N). `Transform()` treats this as `Sort`.
+    KWayMerge,
+};
+
+inline std::size_t HashCombine(std::size_t Seed, std::size_t Value)
+{
+    return Seed ^ (Value + 0x9e3779b97f4a7c15ull + (Seed << 6) + (Seed >> 2));
+}
+
+template<typename ValueType>
+concept CStdHashable = requires(const ValueType& Value) {
+    { std::hash<ValueType>{}(Value) } -> std::convertible_to<std::size_t>;
+};
+
+// User state structs opt in to hashing by providing a `GetTypeHash()` member.
+// A member works for the function local structs the examples use:
+//
+//     std::size_t GetTypeHash() const { return HashCombine(X, Y); }
+template<typename ValueType>
+concept CTypeHashable = requires(const ValueType& Value) {
+    { Value.GetTypeHash() } -> std::convertible_to<std::size_t>;
+};
+
+// Hashing trait used by `EMergeStrategy::Hash`. May be specialised for types
+// that can't be given a `GetTypeHash()` member.
+template<typename ValueType> struct TValueHash
+{
+};
+
+template<typename ValueType>
+concept CHashable = requires(const ValueType& Value) {
+    { TValueHash<ValueType>{}(Value) } -> std::convertible_to<std::size_t>;
+};
+
+template<CStdHashable ValueType> struct TValueHash<ValueType>
+{
+    std::size_t operator()(const ValueType& Value) const
+    {
+        return std::hash<ValueType>{}(Value);
+    }
+};
+
+template<typename ValueType>
+    requires(!CStdHashable<ValueType> && CTypeHashable<ValueType>)
+struct TValueHash<ValueType>
+{
+    std::size_t operator()(const ValueType& Value) const
+    {
+        return Value.GetTypeHash();
+    }
+};
+
+template<CHashable ElementType>
+    requires(!CStdHashable<std::vector<ElementType>>)
+struct TValueHash<std::vector<ElementType>>
+{
+    std::size_t operator()(const std::vector<ElementType>& Vector) const
+    {
+        std::size_t Seed = Vector.size();
+        for (const ElementType& Element : Vector)
+        {
+            Seed = HashCombine(Seed, TValueHash<ElementType>{}(Element));
+        }
+        return Seed;
+    }
+};
+
+// User state structs whose components are interchangeable, such as two
+// identical monsters, opt in to symmetry reduction by providing a
+// `Canonicalise()` member that returns one chosen representative of all the
+// states equivalent to this one, for example with the components sorted:
+//
+//     FState Canonicalise() const { return Ogre2 < Ogre1 ? Swapped() : *this; }
+//
+// The iterate drivers and `BuildMatrix()` replace states by their
+// representatives between whole steps, so equivalent states become one atom.
+// A step must treat equivalent states alike as a whole but may tell the
+// components apart part way through, as when each monster moves in turn.
+template<typename ValueType>
+concept CMemberCanonicalisable = requires(const ValueType& Value) {
+    { Value.Canonicalise() } -> std::convertible_to<ValueType>;
+};
+
+// Symmetry trait used by `ReduceSymmetry()`. May be specialised for types
+// that can't be given a `Canonicalise()` member.
+template<typename ValueType> struct TStateSymmetry
+{
+};
+
+template<CMemberCanonicalisable ValueType> struct TStateSymmetry<ValueType>
+{
+    ValueType operator()(const ValueType& Value) const
+    {
+        return Value.Canonicalise();
+    }
+};
+
+template<typename ValueType>
+concept CSymmetric = requires(const ValueType& Value) {
+    { TStateSymmetry<ValueType>{}(Value) } -> std::convertible_to<ValueType>;
+};
+
+// The representative of `Value` under its type's symmetry, or `Value` itself
+// for types without one.
+template<typename ValueType>
+ValueType CanonicalState(const ValueType& Value)
+{
+    if constexpr (CSymmetric<ValueType>)
+    {
+        return TStateSymmetry<ValueType>{}(Value);
+    }
+    else
+    {
+        return Value;
+    }
+}
+
+#ifdef __SIZEOF_INT128__
+using FSortKey128 = unsigned __int128;
+#endif
+
+template<typename KeyType>
+concept CSortKey = std::same_as<KeyType, std::uint64_t>
+#ifdef __SIZEOF_INT128__
+                   || std::same_as<KeyType, FSortKey128>
+#endif
+    ;
+
+// User state structs opt in to radix sorting by providing a `GetSortKey()`
+// member that packs the state into an unsigned 64 or 128 bit integer whose
+// order is the same as the state's `<`. `PackSortKey()` builds one from a
+// few integer fields:
+//
+//     std::uint64_t GetSortKey() const { return PackSortKey(X, Y); }
+template<typename ValueType>
+concept CMemberSortKey = requires(const ValueType& Value) {
+    { Value.GetSortKey() } -> CSortKey;
+};
+
+// Sort key trait used by `Sort()`. May be specialised for types that can't
+// be given a `GetSortKey()` member.
+template<typename ValueType> struct TSortKey
+{
+};
+
+template<CMemberSortKey ValueType> struct TSortKey<ValueType>
+{
+    auto operator()(const ValueType& Value) const
+    {
+        return Value.GetSortKey();
+    }
+};
+
+template<typename ValueType>
+    requires(std::integral<ValueType> && !std::same_as<ValueType, bool> &&
+             sizeof(ValueType) <= sizeof(std::uint64_t))
+struct TSortKey<ValueType>
+{
+    std::uint64_t operator()(ValueType Value) const
+    {
+        // Flipping the sign bit puts negative values first.
+        constexpr std::uint64_t Bias =
+            std::is_signed_v<ValueType> ? std::uint64_t(1) << 63 : 0;
+        return static_cast<std::uint64_t>(static_cast<std::int64_t>(Value)) ^
+               Bias;
+    }
+};
+
+template<typename ValueType>
+concept CRadixSortable = requires(const ValueType& Value) {
+    { TSortKey<ValueType>{}(Value) } -> CSortKey;
+};
+
+// One field of a packed sort key as 32 bits that order like the field. Signed
+// fields have their sign bit flipped so negative values sort first; unsigned
+// ones are already in order.
+template<std::integral FieldType> std::uint32_t SortKeyDigit(FieldType Field)
+{
+    static_assert(sizeof(FieldType) <= sizeof(std::uint32_t),
+                  "PackSortKey() fields must be 32 bits or narrower");
+
+    if constexpr (std::is_signed_v<FieldType>)
+    {
+        return static_cast<std::uint32_t>(static_cast<std::int32_t>(Field)) ^
+               0x80000000u;
+    }
+    else
+    {
+        return static_cast<std::uint32_t>(Field);
+    }
+}
+
+// Packs up to two integer fields of at most 32 bits into a 64 bit key, or up
+// to four into a 128 bit one, ordered like a tuple of the fields.
+template<std::integral... FieldTypes>
+    requires(sizeof...(FieldTypes) >= 1 && sizeof...(FieldTypes) <= 4)
+auto PackSortKey(FieldTypes... Fields)
+{
+#ifdef __SIZEOF_INT128__
+    using KeyType = std::conditional_t<(sizeof...(FieldTypes) <= 2),
+                                       std::uint64_t,
+                                       FSortKey128>;
+#else
+    static_assert(sizeof...(FieldTypes) <= 2,
+                  "128 bit sort keys aren't available on this compiler");
+    using KeyType = std::uint64_t;
+#endif
+
+    KeyType Key = 0;
+    ((Key = (Key << 32) | SortKeyDigit(Fields)), ...);
+    return Key;
+}
+
+// Below this many atoms `Sort()` uses `std::sort()` even for radix sortable
+// values.
+inline constexpr std::size_t RadixSortMinAtoms = 256;
+
+// Running sum with Neumaier's compensation: the rounding error of every
+// addition is carried separately and added back at the end. Probability types
+// narrower than `double` are summed in `double`, since a `float`
+// compensation term itself loses too much over a million additions. Merging
+// many atoms into one then stays accurate to about one rounding of the
+// result. Exact probability types are just added up.
+template<typename ProbType> struct TCompensatedSum
+{
+    using FAccumulator = std::conditional_t<std::is_floating_point_v<ProbType> &&
+                                                (sizeof(ProbType) < sizeof(double)),
+                                            double,
+                                            ProbType>;
+
+    void Add(ProbType InValue)
+    {
+        if constexpr (std::is_floating_point_v<ProbType>)
+        {
+            const FAccumulator Value = InValue;
+            const FAccumulator Total = Sum + Value;
+            Compensation += std::abs(Sum) >= std::abs(Value)
+                                ? (Sum - Total) + Value
+                                : (Value - Total) + Sum;
+            Sum = Total;
+        }
+        else
+        {
+            Sum += InValue;
+        }
+    }
+
+    ProbType Result() const
+    {
+        if constexpr (std::is_floating_point_v<ProbType>)
+        {
+            return static_cast<ProbType>(Sum + Compensation);
+        }
+        else
+        {
+            return Sum;
+        }
+    }
+
+    FAccumulator Sum = 0;
+    FAccumulator Compensation = 0;
+};
+
+// Number of atoms a `TDist<>` stores inside the object before its `PDF`
+// allocates from the thread's current resource. Most distributions built in
+// continuations, like `Certainly()` or `Roll(6)`, are smaller than this.
+// Defaults to whatever fits in `InlineAtomBytes` and may be specialised per
+// value type, with zero meaning always allocate. Every `TDist<>` carries this
+// buffer, so it is kept small: 128 bytes holds eight `TAtom<double, int>`.
+inline constexpr std::size_t InlineAtomBytes = 128;
+
+template<typename ProbType, typename ValueType> struct TInlineAtoms
+{
+    static constexpr std::size_t Value = std::max<std::size_t>(
+        1, InlineAtomBytes / sizeof(TAtom<ProbType, ValueType>));
+};
+
+template<typename ProbType, typename ValueType>
+using TAtomArray = TSmallVector<TAtom<ProbType, ValueType>,
+                                TInlineAtoms<ProbType, ValueType>::Value,
+                                TDistAllocator<TAtom<ProbType, ValueType>>>;
+
+// Accumulates atoms, summing the probabilities of equal values as they are
+// added. Atoms are kept in insertion order and indexed by an open addressing
+// table of positions so each distinct value is stored once. Each value's sum
+// is compensated and only written to its atom by `TakeAtoms()`.
+template<typename ProbType, typename ValueType> struct TAtomAccumulator
+{
+    void Add(ValueType Value, ProbType Prob)
+    {
+        if (2 * (Atoms.size() + 1) > Slots.size())
+        {
+            Grow();
+        }
+
+        const std::size_t Mask = Slots.size() - 1;
+        for (std::size_t Slot = Mix(TValueHash<ValueType>{}(Value)) & Mask;;
+             Slot = (Slot + 1) & Mask)
+        {
+            const std::size_t Index = Slots[Slot];
+            if (Index == 0)
+            {
+                Slots[Slot] = Atoms.size() + 1;
+                Atoms.push_back(
+                    TAtom<ProbType, ValueType>{ std::move(Value), Prob });
+                Sums.push_back(TCompensatedSum<ProbType>{ Prob });
+                return;
+            }
+            if (Atoms[Index - 1].Value == Value)
+            {
+                Sums[Index - 1].Add(Prob);
+                return;
+            }
+        }
+    }
+
+    TAtomArray<ProbType, ValueType> TakeAtoms()
+    {
+        for (std::size_t I = 0; I < Atoms.size(); ++I)
+        {
+            Atoms[I].Prob = Sums[I].Result();
+        }
+        Slots.clear();
+        Sums.clear();
+        return std::move(Atoms);
+    }
+
+    TAtomArray<ProbType, ValueType>        Atoms;
+    TDistVector<TCompensatedSum<ProbType>> Sums;
+    TDistVector<std::size_t>               Slots;
+
+private:
+    static std::size_t Mix(std::size_t Hash)
+    {
+        // Many `std::hash<>` implementations are the identity on integers so
+        // spread the bits before masking.
+        return (Hash * 0x9e3779b97f4a7c15ull) >> 16;
+    }
+
+    void Grow()
+    {
+        Slots.assign(std::max<std::size_t>(16, 2 * Slots.size()), 0);
+        const std::size_t Mask = Slots.size() - 1;
+        for (std::size_t Index = 0; Index < Atoms.size(); ++Index)
+        {
+            std::size_t Slot =
+                Mix(TValueHash<ValueType>{}(Atoms[Index].Value)) & Mask;
+            while (Slots[Slot] != 0)
+            {
+                Slot = (Slot + 1) & Mask;
+            }
+            Slots[Slot] = Index + 1;
+        }
+    }
+};
+
+// Opt-in approximation that bounds the growth of long iterations by dropping
+// unlikely atoms. The dropped probability is recorded in
+// `TDist<>::Discarded`.
+struct FPruning
+{
+    // Atoms less likely than this are dropped.
+    double Threshold = 0;
+    // If non-zero, only this many of the most likely atoms are kept.
+    std::size_t MaxAtoms = 0;
+};
+
+// Checks the functions passed to `TransformMonotone()` and friends in debug
+// builds.
+#ifndef CHANCESCRIPT_CHECK_TRANSFORMS
+#define CHANCESCRIPT_CHECK_TRANSFORMS 0
+#endif
+
+// Signed arithmetic types, on which adding a constant or multiplying by a
+// positive one preserves order, overflow aside.
+template<typename ValueType>
+concept COrderedArithmetic =
+    std::is_arithmetic_v<ValueType> && std::is_signed_v<ValueType>;
+
 // For convenience `TDist<>` objects support overloading of arithmetic operators
 // and these are helpers to determine the correct return type.
 template<typename ValueType1, typename ValueType2>
@@ -27,156 +440,1077 @@ template<typename ProbType, typename ValueType> struct TDist
         canonicalise();
     }
 
-    TDist(const std::vector<TAtom<ProbType, ValueType>>& InPDF) : PDF(InPDF)
-    {
-        canonicalise();
+    TDist(const std::vector<TAtom<ProbType, ValueType>>& InPDF)
+        : PDF(InPDF.begin(), InPDF.end())
+    {
+        canonicalise();
+    }
+
+    // Operators
+    template<typename OtherType>
+    TDist<ProbType, AddResultType<ValueType, OtherType>>
+    operator+(const TDist<ProbType, OtherType>& Other) const
+    {
+        if constexpr (CDenseValue<ValueType> &&
+                      std::same_as<ValueType, OtherType>)
+        {
+            if (HasCompactSupport() && Other.HasCompactSupport())
+            {
+                TDist result = TDenseDist<ProbType, ValueType>(*this) +
+                               TDenseDist<ProbType, ValueType>(Other);
+                result.Discarded = Discarded + Other.Discarded;
+                return result;
+            }
+        }
+
+        return AndThen(
+            [&Other](const ValueType& x)
+            {
+                return Other.Transform([&x](const OtherType& y)
+                                       { return x + y; });
+            });
+    }
+
+    // Comparisons between independent random variables. Both supports are
+    // sorted so a single sweep gives P(X < Y), P(X = Y) and P(X > Y).
+    template<typename OtherType>
+    TDist<ProbType, bool>
+    operator<=(const TDist<ProbType, OtherType>& Other) const
+    {
+        const FComparison Comparison = CompareWith(Other);
+        return Bernoulli(Comparison.Greater,
+                         Comparison.Less + Comparison.Equal,
+                         Discarded + Other.Discarded);
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool>
+    operator>=(const TDist<ProbType, OtherType>& Other) const
+    {
+        const FComparison Comparison = CompareWith(Other);
+        return Bernoulli(Comparison.Less,
+                         Comparison.Greater + Comparison.Equal,
+                         Discarded + Other.Discarded);
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool>
+    operator<(const TDist<ProbType, OtherType>& Other) const
+    {
+        const FComparison Comparison = CompareWith(Other);
+        return Bernoulli(Comparison.Greater + Comparison.Equal,
+                         Comparison.Less,
+                         Discarded + Other.Discarded);
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool>
+    operator>(const TDist<ProbType, OtherType>& Other) const
+    {
+        const FComparison Comparison = CompareWith(Other);
+        return Bernoulli(Comparison.Less + Comparison.Equal,
+                         Comparison.Greater,
+                         Discarded + Other.Discarded);
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool>
+    operator==(const TDist<ProbType, OtherType>& Other) const
+    {
+        const FComparison Comparison = CompareWith(Other);
+        return Bernoulli(Comparison.Less + Comparison.Greater,
+                         Comparison.Equal,
+                         Discarded + Other.Discarded);
+    }
+
+    struct FComparison
+    {
+        ProbType Less;
+        ProbType Equal;
+        ProbType Greater;
+    };
+
+    // Sweeps both sorted supports computing the probabilities of this value
+    // being less than, equal to or greater than `Other`'s. Each is a sum of
+    // products of probabilities so no probabilities near one are subtracted.
+    template<typename OtherType>
+    FComparison CompareWith(const TDist<ProbType, OtherType>& Other) const
+    {
+        // Above[j] is the probability of `Other` taking one of the values
+        // from index `j` onwards.
+        std::vector<ProbType> Above(Other.PDF.size() + 1, 0);
+        for (std::size_t J = Other.PDF.size(); J-- > 0;)
+        {
+            Above[J] = Above[J + 1] + Other.PDF[J].Prob;
+        }
+
+        FComparison Comparison{ 0, 0, 0 };
+        ProbType    Below = 0;
+        std::size_t J = 0;
+        for (const auto& [Value, Prob] : PDF)
+        {
+            while (J < Other.PDF.size() && Other.PDF[J].Value < Value)
+            {
+                Below += Other.PDF[J++].Prob;
+            }
+
+            ProbType    Equal = 0;
+            std::size_t K = J;
+            if (K < Other.PDF.size() && !(Value < Other.PDF[K].Value))
+            {
+                Equal = Other.PDF[K++].Prob;
+            }
+
+            Comparison.Less += Prob * Above[K];
+            Comparison.Equal += Prob * Equal;
+            Comparison.Greater += Prob * Below;
+        }
+
+        return Comparison;
+    }
+
+    static TDist<ProbType, bool> Bernoulli(ProbType False, ProbType True,
+                                           ProbType InDiscarded = 0)
+    {
+        TDist<ProbType, bool> result{};
+        result.Discarded = InDiscarded;
+        result.PDF.push_back(TAtom<ProbType, bool>{ false, False });
+        result.PDF.push_back(TAtom<ProbType, bool>{ true, True });
+        result.remove_zero();
+
+        return result;
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, AddResultType<ValueType, OtherType>>
+    operator+(const OtherType& Other) const
+    {
+        auto Add = [&Other](const ValueType& x) { return x + Other; };
+        if constexpr (COrderedArithmetic<ValueType> &&
+                      COrderedArithmetic<OtherType>)
+        {
+            if constexpr (std::integral<AddResultType<ValueType, OtherType>>)
+            {
+                return TransformStrictlyMonotone(Add);
+            }
+            else
+            {
+                // Rounding can make distinct values equal.
+                return TransformMonotone(Add);
+            }
+        }
+        else
+        {
+            return Transform(Add);
+        }
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool> operator<=(const OtherType& Other) const
+    {
+        return Indicator([&Other](const ValueType& x) { return x <= Other; });
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool> operator>=(const OtherType& Other) const
+    {
+        return Indicator([&Other](const ValueType& x) { return x >= Other; });
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool> operator<(const OtherType& Other) const
+    {
+        return Indicator([&Other](const ValueType& x) { return x < Other; });
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool> operator>(const OtherType& Other) const
+    {
+        return Indicator([&Other](const ValueType& x) { return x > Other; });
+    }
+
+    template<typename OtherType>
+    TDist<ProbType, bool> operator==(const OtherType& Other) const
+    {
+        return Indicator([&Other](const ValueType& x) { return x == Other; });
+    }
+
+    // The distribution of `Predicate(X)`, found by summing rather than
+    // sorting.
+    template<typename F> TDist<ProbType, bool> Indicator(const F& Predicate) const
+    {
+        ProbType False = 0;
+        ProbType True = 0;
+        for (const auto& [Value, Prob] : PDF)
+        {
+            (Predicate(Value) ? True : False) += Prob;
+        }
+
+        return Bernoulli(False, True, Discarded);
+    }
+
+    // `Transform()` for an `f` that never decreases. The results come out
+    // sorted so only equal neighbours need merging.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    TransformMonotone(const F& f) const
+    {
+        auto result = MapValues(f);
+        result.CheckSorted(false);
+        result.Merge();
+
+        return result;
+    }
+
+    // `Transform()` for an `f` that never maps two values to the same
+    // result, so nothing needs merging.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    TransformInjective(const F& f) const
+    {
+        auto result = MapValues(f);
+        result.Sort();
+        result.CheckSorted(true);
+
+        return result;
+    }
+
+    // `Transform()` for an increasing `f`. The result is canonical as it is.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    TransformStrictlyMonotone(const F& f) const
+    {
+        auto result = MapValues(f);
+        result.CheckSorted(true);
+
+        return result;
+    }
+
+    // Applies `f` to each value, keeping the order and probabilities.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    MapValues(const F& f) const
+    {
+        TDist<ProbType, std::invoke_result_t<F, ValueType>> result{};
+        result.Discarded = Discarded;
+        result.PDF.reserve(PDF.size());
+        for (const auto& x : PDF)
+        {
+            result.PDF.push_back(TAtom{ f(x.Value), x.Prob });
+        }
+
+        return result;
+    }
+
+    // Asserts, when `CHANCESCRIPT_CHECK_TRANSFORMS` is set, that the values
+    // are sorted and, if `bStrict`, distinct. Used to catch functions passed
+    // to the ordered `Transform()` variants that aren't what they claim.
+    void CheckSorted([[maybe_unused]] bool bStrict) const
+    {
+#if CHANCESCRIPT_CHECK_TRANSFORMS
+        for (std::size_t I = 1; I < PDF.size(); ++I)
+        {
+            assert(!(PDF[I].Value < PDF[I - 1].Value));
+            assert(!bStrict || PDF[I - 1].Value < PDF[I].Value);
+        }
+#endif
+    }
+
+    // Assumes values are sorted.  Merges two successive values together if they
+    // are in fact equal. Compacts in place.
+    void Merge()
+    {
+        auto                      Out = PDF.begin();
+        TCompensatedSum<ProbType> Run;
+        for (auto In = PDF.begin(); In != PDF.end(); ++In)
+        {
+            if (Out != PDF.begin() && (Out - 1)->Value == In->Value)
+            {
+                Run.Add(In->Prob);
+            }
+            else
+            {
+                if (Out != PDF.begin())
+                {
+                    (Out - 1)->Prob = Run.Result();
+                }
+                Run = TCompensatedSum<ProbType>{ In->Prob };
+                if (Out != In)
+                {
+                    *Out = std::move(*In);
+                }
+                ++Out;
+            }
+        }
+        if (Out != PDF.begin())
+        {
+            (Out - 1)->Prob = Run.Result();
+        }
+
+        PDF.erase(Out, PDF.end());
+    }
+
+    void Sort()
+    {
+        if constexpr (CRadixSortable<ValueType>)
+        {
+            if (PDF.size() >= RadixSortMinAtoms)
+            {
+                RadixSort();
+                return;
+            }
+        }
+
+        std::sort(PDF.begin(), PDF.end());
+    }
+
+    // Sorts by `TSortKey<>` with a least significant digit first radix sort,
+    // a byte at a time, skipping bytes that are the same in every key. The
+    // keys are sorted along with each atom's position and the atoms are
+    // moved into place once at the end.
+    void RadixSort()
+    {
+        using KeyType = decltype(TSortKey<ValueType>{}(PDF[0].Value));
+
+        struct FItem
+        {
+            KeyType     Key;
+            std::size_t Index;
+        };
+
+        const std::size_t  NumAtoms = PDF.size();
+        TDistVector<FItem> Items(NumAtoms);
+        TDistVector<FItem> Scratch(NumAtoms);
+
+        constexpr std::size_t NumBytes = sizeof(KeyType);
+        std::array<std::array<std::size_t, 256>, NumBytes> Counts{};
+        for (std::size_t I = 0; I < NumAtoms; ++I)
+        {
+            Items[I] = FItem{ TSortKey<ValueType>{}(PDF[I].Value), I };
+            for (std::size_t Byte = 0; Byte < NumBytes; ++Byte)
+            {
+                ++Counts[Byte][(Items[I].Key >> (8 * Byte)) & 0xff];
+            }
+        }
+
+        for (std::size_t Byte = 0; Byte < NumBytes; ++Byte)
+        {
+            auto& Count = Counts[Byte];
+            if (Count[(Items[0].Key >> (8 * Byte)) & 0xff] == NumAtoms)
+            {
+                continue;
+            }
+
+            std::size_t Offset = 0;
+            for (auto& Bucket : Count)
+            {
+                Offset += std::exchange(Bucket, Offset);
+            }
+            for (const FItem& Item : Items)
+            {
+                Scratch[Count[(Item.Key >> (8 * Byte)) & 0xff]++] = Item;
+            }
+            std::swap(Items, Scratch);
+        }
+
+        TAtomArray<ProbType, ValueType> Sorted;
+        Sorted.reserve(NumAtoms);
+        for (const FItem& Item : Items)
+        {
+            Sorted.push_back(std::move(PDF[Item.Index]));
+        }
+        PDF = std::move(Sorted);
+    }
+
+    void remove_zero()
+    {
+        PDF.erase(std::remove_if(PDF.begin(),
+                                 PDF.end(),
+                                 [](const TAtom<ProbType, ValueType>& p)
+                                 { return p.Prob == 0; }),
+                  PDF.end());
+    }
+
+    void chop(ProbType eps)
+    {
+        PDF.erase(std::remove_if(PDF.begin(),
+                                 PDF.end(),
+                                 [this, eps](const TAtom<ProbType, ValueType>& p)
+                                 {
+                                     if (std::abs(p.Prob) < eps)
+                                     {
+                                         Discarded += std::abs(p.Prob);
+                                         return true;
+                                     }
+                                     return false;
+                                 }),
+                  PDF.end());
+    }
+
+    // Drops the atoms `Pruning` asks for, adding their probability to
+    // `Discarded`. When keeping the `MaxAtoms` most likely atoms, ties at the
+    // cutoff are broken in favour of smaller values.
+    void Prune(const FPruning& Pruning)
+    {
+        if (Pruning.Threshold <= 0 && Pruning.MaxAtoms == 0)
+        {
+            return;
+        }
+
+        ProbType    Cutoff = 0;
+        std::size_t NumAtCutoff = PDF.size();
+        if (Pruning.MaxAtoms > 0 && PDF.size() > Pruning.MaxAtoms)
+        {
+            TDistVector<ProbType> Probs;
+            Probs.reserve(PDF.size());
+            for (const auto& [Value, Prob] : PDF)
+            {
+                Probs.push_back(Prob);
+            }
+            const auto Kept = Probs.begin() + (Pruning.MaxAtoms - 1);
+            std::nth_element(Probs.begin(), Kept, Probs.end(), std::greater<>());
+            Cutoff = *Kept;
+            NumAtCutoff = static_cast<std::size_t>(
+                std::count(Probs.begin(), Kept + 1, Cutoff));
+        }
+
+        auto Out = PDF.begin();
+        for (auto In = PDF.begin(); In != PDF.end(); ++In)
+        {
+            bool bKeep = In->Prob >= Pruning.Threshold && In->Prob >= Cutoff;
+            if (bKeep && In->Prob == Cutoff)
+            {
+                bKeep = NumAtCutoff > 0;
+                NumAtCutoff -= bKeep;
+            }
+            if (!bKeep)
+            {
+                Discarded += In->Prob;
+            }
+            else
+            {
+                if (Out != In)
+                {
+                    *Out = std::move(*In);
+                }
+                ++Out;
+            }
+        }
+
+        PDF.erase(Out, PDF.end());
+    }
+
+    // Replaces every value by its `CanonicalState()` and merges the atoms
+    // that then coincide. Does nothing for value types without a symmetry.
+    void ReduceSymmetry()
+    {
+        if constexpr (CSymmetric<ValueType>)
+        {
+            for (auto& Atom : PDF)
+            {
+                Atom.Value = CanonicalState(Atom.Value);
+            }
+            canonicalise();
+        }
+    }
+
+    void canonicalise()
+    {
+        if constexpr (std::integral<ValueType>)
+        {
+            if (BucketCanonicalise())
+            {
+                return;
+            }
+        }
+
+        Sort();
+        Merge();
+        remove_zero();
     }
 
-    // Operators
-    template<typename OtherType>
-    TDist<ProbType, AddResultType<ValueType, OtherType>>
-    operator+(const TDist<ProbType, OtherType>& Other) const
+    // True if the values span a range small enough, relative to the number of
+    // atoms, to be worth storing densely.
+    bool HasCompactSupport() const
     {
-        return AndThen(
-            [&Other](int x)
-            { return Other.Transform([x](int y) { return x + y; }); });
+        if (PDF.empty())
+        {
+            return false;
+        }
+        auto [Lowest, Highest] = std::minmax_element(PDF.begin(), PDF.end());
+        return IsCompactSpan(Lowest->Value, Highest->Value, PDF.size());
     }
 
-    template<typename OtherType>
-    TDist<ProbType, bool>
-    operator<=(const TDist<ProbType, OtherType>& Other) const
+    static bool IsCompactSpan(ValueType Lowest, ValueType Highest,
+                              std::size_t NumAtoms)
     {
-        return AndThen(
-            [&Other](int x)
-            { return Other.Transform([x](int y) { return x <= y; }); });
+        const auto Span = static_cast<unsigned long long>(Highest) -
+                          static_cast<unsigned long long>(Lowest);
+        return Span < 4 * NumAtoms + 64;
     }
 
-    template<typename OtherType>
-    TDist<ProbType, bool>
-    operator>=(const TDist<ProbType, OtherType>& Other) const
+    // Canonicalises integer valued distributions by summing into an array
+    // indexed by value, avoiding the sort. Returns false, leaving `PDF`
+    // untouched, if the values are too spread out for that to pay off.
+    bool BucketCanonicalise()
     {
-        return AndThen(
-            [&Other](int x)
-            { return Other.Transform([x](int y) { return x >= y; }); });
+        if (PDF.size() < 2)
+        {
+            remove_zero();
+            return true;
+        }
+
+        auto [LowestAtom, HighestAtom] =
+            std::minmax_element(PDF.begin(), PDF.end());
+        const ValueType Lowest = LowestAtom->Value;
+        const ValueType Highest = HighestAtom->Value;
+        if (!IsCompactSpan(Lowest, Highest, PDF.size()))
+        {
+            return false;
+        }
+
+        // Small distributions, like the ones continuations return, need no
+        // allocation.
+        using FBucket = TCompensatedSum<ProbType>;
+        TSmallVector<FBucket, 128, TDistAllocator<FBucket>> Buckets(
+            static_cast<std::size_t>(Highest - Lowest) + 1, FBucket{});
+        for (const auto& [Value, Prob] : PDF)
+        {
+            Buckets[static_cast<std::size_t>(Value - Lowest)].Add(Prob);
+        }
+
+        PDF.clear();
+        for (std::size_t I = 0; I < Buckets.size(); ++I)
+        {
+            const ProbType Prob = Buckets[I].Result();
+            if (Prob != 0)
+            {
+                PDF.push_back(TAtom<ProbType, ValueType>{
+                    static_cast<ValueType>(Lowest + I), Prob });
+            }
+        }
+
+        return true;
     }
 
-    template<typename OtherType>
-    TDist<ProbType, AddResultType<ValueType, OtherType>>
-    operator+(const OtherType& Other) const
+    template<typename F>
+    std::invoke_result_t<F, ValueType>
+    AndThen(const F& f, EMergeStrategy Strategy = EMergeStrategy::Sort) const&
     {
-        return Transform([&Other](int x) { return x + Other; });
+        using ResultType = std::invoke_result_t<F, ValueType>;
+        using ResultValueType = typename TDistTypes<ResultType>::Value;
+
+        if constexpr (CHashable<ResultValueType>)
+        {
+            if (Strategy == EMergeStrategy::Hash)
+            {
+                TAtomAccumulator<typename TDistTypes<ResultType>::Prob,
+                                 ResultValueType>
+                         Accumulator;
+                ProbType Lost = Discarded;
+                for (const auto& x : PDF)
+                {
+                    auto fx = f(x.Value);
+                    for (auto& r : fx.PDF)
+                    {
+                        Accumulator.Add(std::move(r.Value), x.Prob * r.Prob);
+                    }
+                    Lost += x.Prob * fx.Discarded;
+                }
+
+                auto result = FromDistinctAtoms<ResultType>(Accumulator);
+                result.Discarded = Lost;
+                return result;
+            }
+        }
+
+        if (Strategy == EMergeStrategy::KWayMerge)
+        {
+            TDistVector<ResultType> Runs;
+            Runs.reserve(PDF.size());
+            for (const auto& x : PDF)
+            {
+                Runs.push_back(f(x.Value));
+            }
+
+            return MergeRuns(Runs);
+        }
+
+        ResultType result{};
+        result.Discarded = Discarded;
+        for (const auto& x : PDF)
+        {
+            auto fx = f(x.Value);
+            const ProbType Prob = x.Prob;
+            for (auto& r : fx.PDF)
+            {
+                result.PDF.push_back(TAtom{ std::move(r.Value), Prob * r.Prob });
+            }
+            result.Discarded += Prob * fx.Discarded;
+        }
+
+        result.canonicalise();
+
+        return result;
     }
 
-    template<typename OtherType>
-    TDist<ProbType, bool> operator<=(const OtherType& Other) const
+    // Reuses this distribution's buffer when the continuation returns the
+    // same type: each expansion is appended after the existing atoms, which
+    // are dropped at the end, so `Dist = std::move(Dist).AndThen(f)` stops
+    // allocating once the buffer is large enough.
+    template<typename F>
+    std::invoke_result_t<F, ValueType>
+    AndThen(const F& f, EMergeStrategy Strategy = EMergeStrategy::Sort) &&
     {
-        return Transform([&Other](int x) { return x <= Other; });
+        if constexpr (std::same_as<std::invoke_result_t<F, ValueType>, TDist>)
+        {
+            if (Strategy == EMergeStrategy::Sort)
+            {
+                const std::size_t NumSource = PDF.size();
+                for (std::size_t I = 0; I < NumSource; ++I)
+                {
+                    auto           fx = f(PDF[I].Value);
+                    const ProbType Prob = PDF[I].Prob;
+                    for (auto& r : fx.PDF)
+                    {
+                        PDF.push_back(TAtom{ std::move(r.Value), Prob * r.Prob });
+                    }
+                    Discarded += Prob * fx.Discarded;
+                }
+                PDF.erase(PDF.begin(), PDF.begin() + NumSource);
+                canonicalise();
+
+                return std::move(*this);
+            }
+        }
+
+        return std::as_const(*this).AndThen(f, Strategy);
     }
 
-    template<typename OtherType>
-    TDist<ProbType, bool> operator>=(const OtherType& Other) const
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    Transform(const F& f, EMergeStrategy Strategy = EMergeStrategy::Sort) const&
     {
-        return Transform([&Other](int x) { return x >= Other; });
+        using ResultType = TDist<ProbType, std::invoke_result_t<F, ValueType>>;
+
+        if constexpr (CHashable<std::invoke_result_t<F, ValueType>>)
+        {
+            if (Strategy == EMergeStrategy::Hash)
+            {
+                TAtomAccumulator<ProbType, std::invoke_result_t<F, ValueType>>
+                    Accumulator;
+                for (const auto& x : PDF)
+                {
+                    Accumulator.Add(f(x.Value), x.Prob);
+                }
+
+                auto result = FromDistinctAtoms<ResultType>(Accumulator);
+                result.Discarded = Discarded;
+                return result;
+            }
+        }
+
+        ResultType result{};
+        result.Discarded = Discarded;
+        result.PDF.reserve(PDF.size());
+        for (const auto& x : PDF)
+        {
+            result.PDF.push_back(TAtom{ f(x.Value), x.Prob });
+        }
+
+        result.canonicalise();
+
+        return result;
     }
 
-    // Assumes values are sorted.  Merges two successive values together if they
-    // are in fact equal.
-    void Merge()
+    // Moves the values into `f`. If the value type is unchanged the results
+    // are written over the old values and this buffer is reused.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    Transform(const F& f, EMergeStrategy Strategy = EMergeStrategy::Sort) &&
     {
-        std::vector<TAtom<ProbType, ValueType>> Merged;
-        for (const auto& TAtom : PDF)
+        using ResultValueType = std::invoke_result_t<F, ValueType>;
+
+        if constexpr (CHashable<ResultValueType>)
         {
-            if (!Merged.empty() && Merged.back().Value == TAtom.Value)
+            if (Strategy == EMergeStrategy::Hash)
             {
-                Merged.back().Prob += TAtom.Prob;
+                TAtomAccumulator<ProbType, ResultValueType> Accumulator;
+                for (auto& x : PDF)
+                {
+                    Accumulator.Add(f(std::move(x.Value)), x.Prob);
+                }
+
+                auto result =
+                    FromDistinctAtoms<TDist<ProbType, ResultValueType>>(
+                        Accumulator);
+                result.Discarded = Discarded;
+                return result;
             }
-            else
+        }
+
+        if constexpr (std::same_as<ResultValueType, ValueType>)
+        {
+            for (auto& x : PDF)
             {
-                Merged.push_back(TAtom);
+                x.Value = f(std::move(x.Value));
             }
+            canonicalise();
+
+            return std::move(*this);
         }
+        else
+        {
+            TDist<ProbType, ResultValueType> result{};
+            result.Discarded = Discarded;
+            result.PDF.reserve(PDF.size());
+            for (auto& x : PDF)
+            {
+                result.PDF.push_back(TAtom{ f(std::move(x.Value)), x.Prob });
+            }
+            result.canonicalise();
 
-        PDF = std::move(Merged);
+            return result;
+        }
     }
 
-    void Sort() { std::sort(PDF.begin(), PDF.end()); }
-
-    void remove_zero()
+    // Multi-threaded `AndThen()`. The atoms are split into fixed size chunks,
+    // each chunk is expanded and canonicalised independently, and the partial
+    // results are merged pairwise in a fixed tree order. The result is the
+    // same to the last bit for any number of threads, though it may differ in
+    // the last bits from the single-threaded overload, which sums in a
+    // different order.
+    template<typename F>
+    std::invoke_result_t<F, ValueType> AndThen(const FParallel& Policy,
+                                               const F& f) const
     {
-        PDF.erase(std::remove_if(PDF.begin(),
-                                 PDF.end(),
-                                 [](const TAtom<ProbType, ValueType>& p)
-                                 { return p.Prob == 0; }),
-                  PDF.end());
+        using ResultType = std::invoke_result_t<F, ValueType>;
+
+        return ParallelReduce<ResultType>(
+            Policy,
+            [this, &f](std::size_t Begin, std::size_t End)
+            {
+                ResultType result{};
+                for (std::size_t I = Begin; I < End; ++I)
+                {
+                    auto fx = f(PDF[I].Value);
+                    const auto Prob = PDF[I].Prob;
+                    for (auto& r : fx.PDF)
+                    {
+                        result.PDF.push_back(
+                            TAtom{ std::move(r.Value), Prob * r.Prob });
+                    }
+                    result.Discarded += Prob * fx.Discarded;
+                }
+                result.canonicalise();
+
+                return result;
+            });
     }
 
-    void chop(ProbType eps)
+    // Multi-threaded `Transform()`, reduced in the same way as `AndThen()`.
+    template<typename F>
+    TDist<ProbType, std::invoke_result_t<F, ValueType>>
+    Transform(const FParallel& Policy, const F& f) const
     {
-        PDF.erase(std::remove_if(PDF.begin(),
-                                 PDF.end(),
-                                 [eps](const TAtom<ProbType, ValueType>& p)
-                                 { return abs(p.Prob) < eps; }),
-                  PDF.end());
+        using ResultType = TDist<ProbType, std::invoke_result_t<F, ValueType>>;
+
+        return ParallelReduce<ResultType>(
+            Policy,
+            [this, &f](std::size_t Begin, std::size_t End)
+            {
+                ResultType result{};
+                result.PDF.reserve(End - Begin);
+                for (std::size_t I = Begin; I < End; ++I)
+                {
+                    result.PDF.push_back(TAtom{ f(PDF[I].Value), PDF[I].Prob });
+                }
+                result.canonicalise();
+
+                return result;
+            });
     }
 
-    void canonicalise()
+    // Runs `Chunk(Begin, End)` over consecutive ranges of `ParallelChunkSize`
+    // atoms and merges the canonical partial results. Merging proceeds in
+    // rounds, combining partials `i` and `i + Stride` for each `i` that is a
+    // multiple of `2 Stride`, so the order of every addition is fixed by the
+    // number of chunks alone.
+    template<typename ResultType, typename ChunkType>
+    ResultType ParallelReduce(const FParallel& Policy,
+                              const ChunkType& Chunk) const
     {
-        Sort();
-        Merge();
-        remove_zero();
+        const unsigned    NumThreads = ResolveNumThreads(Policy);
+        const std::size_t NumChunks =
+            (PDF.size() + ParallelChunkSize - 1) / ParallelChunkSize;
+        if (NumChunks == 0)
+        {
+            ResultType result{};
+            result.Discarded = Discarded;
+            return result;
+        }
+
+        // Workers write to the partials so they can't share an arena, which
+        // isn't thread safe, with this thread.
+        std::vector<ResultType> Partials = [NumChunks]
+        {
+            FDistResourceScope Heap(std::pmr::new_delete_resource());
+            return std::vector<ResultType>(NumChunks, ResultType{});
+        }();
+        ParallelFor(NumChunks,
+                    NumThreads,
+                    [&](std::size_t I)
+                    {
+                        const std::size_t Begin = I * ParallelChunkSize;
+                        Partials[I] = Chunk(
+                            Begin,
+                            std::min(PDF.size(), Begin + ParallelChunkSize));
+                    });
+
+        for (std::size_t Stride = 1; Stride < NumChunks; Stride *= 2)
+        {
+            ParallelFor((NumChunks - Stride + 2 * Stride - 1) / (2 * Stride),
+                        NumThreads,
+                        [&](std::size_t I)
+                        {
+                            const std::size_t Left = 2 * Stride * I;
+                            Partials[Left] =
+                                MergeSorted(std::move(Partials[Left]),
+                                            std::move(Partials[Left + Stride]));
+                        });
+        }
+
+        Partials[0].Discarded += Discarded;
+        return std::move(Partials[0]);
     }
 
-    template<typename F>
-    std::invoke_result_t<F, ValueType> AndThen(const F& f) const
+    // Merges two canonical distributions into one, summing the
+    // probabilities of values present in both. Both are left empty. Each sum
+    // is a single rounding, so a tree of these merges over `k` partials
+    // rounds each value at most `log2(k)` times and needs no compensation.
+    template<typename OtherProbType, typename OtherValueType>
+    static TDist<OtherProbType, OtherValueType>
+    MergeSorted(TDist<OtherProbType, OtherValueType>&& A,
+                TDist<OtherProbType, OtherValueType>&& B)
     {
-        std::invoke_result_t<F, ValueType> result{};
-        for (const auto& x : PDF)
+        TDist<OtherProbType, OtherValueType> result{};
+        result.Discarded = A.Discarded + B.Discarded;
+        result.PDF.reserve(A.PDF.size() + B.PDF.size());
+
+        std::size_t I = 0;
+        std::size_t J = 0;
+        while (I < A.PDF.size() && J < B.PDF.size())
         {
-            auto fx = f(x.Value);
-            double Prob = x.Prob;
-            for (auto& r : fx.PDF)
+            if (A.PDF[I].Value < B.PDF[J].Value)
+            {
+                result.PDF.push_back(std::move(A.PDF[I++]));
+            }
+            else if (B.PDF[J].Value < A.PDF[I].Value)
+            {
+                result.PDF.push_back(std::move(B.PDF[J++]));
+            }
+            else
             {
-                result.PDF.push_back(TAtom{ r.Value, Prob * r.Prob });
+                result.PDF.push_back(TAtom<OtherProbType, OtherValueType>{
+                    std::move(A.PDF[I].Value), A.PDF[I].Prob + B.PDF[J].Prob });
+                ++I;
+                ++J;
             }
         }
-
-        result.canonicalise();
+        for (; I < A.PDF.size(); ++I)
+        {
+            result.PDF.push_back(std::move(A.PDF[I]));
+        }
+        for (; J < B.PDF.size(); ++J)
+        {
+            result.PDF.push_back(std::move(B.PDF[J]));
+        }
+        A.PDF.clear();
+        B.PDF.clear();
+        result.remove_zero();
 
         return result;
     }
 
-    template<typename F>
-    TDist<ProbType, std::invoke_result_t<F, ValueType>>
-    Transform(const F& f) const
+    // Merges `Runs[i]`, weighted by the probability of the `i`th atom, into a
+    // single distribution, moving the values out of the runs. Assumes every
+    // run is canonical.
+    template<typename ResultType>
+    ResultType MergeRuns(TDistVector<ResultType>& Runs) const
     {
-        TDist<ProbType, std::invoke_result_t<F, ValueType>> result{};
-        for (const auto& x : PDF)
+        using ResultAtomType = TAtom<typename TDistTypes<ResultType>::Prob,
+                                     typename TDistTypes<ResultType>::Value>;
+        using FRunSum = TCompensatedSum<typename TDistTypes<ResultType>::Prob>;
+
+        struct FCursor
         {
-            auto fx = f(x.Value);
-            result.PDF.push_back(TAtom{ fx, x.Prob });
+            ResultAtomType* Next;
+            ResultAtomType* End;
+            ProbType        Scale;
+        };
+
+        auto Before = [](const FCursor& A, const FCursor& B)
+        { return A.Next->Value < B.Next->Value; };
+
+        // Binary min heap of cursors ordered by their next value.
+        TDistVector<FCursor> Heap;
+        Heap.reserve(Runs.size());
+        std::size_t Total = 0;
+        for (std::size_t I = 0; I < Runs.size(); ++I)
+        {
+            auto& Run = Runs[I].PDF;
+            if (!Run.empty())
+            {
+                Heap.push_back(FCursor{
+                    Run.data(), Run.data() + Run.size(), PDF[I].Prob });
+                Total += Run.size();
+            }
         }
 
-        result.canonicalise();
+        // Restores the heap property below `Hole` after its cursor advanced.
+        auto SiftDown = [&Heap, &Before](std::size_t Hole)
+        {
+            const FCursor Cursor = Heap[Hole];
+            for (std::size_t Child = 2 * Hole + 1; Child < Heap.size();
+                 Child = 2 * Hole + 1)
+            {
+                if (Child + 1 < Heap.size() && Before(Heap[Child + 1], Heap[Child]))
+                {
+                    ++Child;
+                }
+                if (!Before(Heap[Child], Cursor))
+                {
+                    break;
+                }
+                Heap[Hole] = Heap[Child];
+                Hole = Child;
+            }
+            Heap[Hole] = Cursor;
+        };
+
+        for (std::size_t I = Heap.size() / 2; I-- > 0;)
+        {
+            SiftDown(I);
+        }
+
+        ResultType result{};
+        result.Discarded = Discarded;
+        for (std::size_t I = 0; I < Runs.size(); ++I)
+        {
+            result.Discarded += PDF[I].Prob * Runs[I].Discarded;
+        }
+        result.PDF.reserve(Total);
+        FRunSum Run;
+        while (!Heap.empty())
+        {
+            FCursor& Cursor = Heap.front();
+            const auto Prob = Cursor.Scale * Cursor.Next->Prob;
+            if (!result.PDF.empty() &&
+                result.PDF.back().Value == Cursor.Next->Value)
+            {
+                Run.Add(Prob);
+            }
+            else
+            {
+                if (!result.PDF.empty())
+                {
+                    result.PDF.back().Prob = Run.Result();
+                }
+                Run = FRunSum{ Prob };
+                result.PDF.push_back(
+                    ResultAtomType{ std::move(Cursor.Next->Value), Prob });
+            }
+
+            if (++Cursor.Next == Cursor.End)
+            {
+                Cursor = Heap.back();
+                Heap.pop_back();
+            }
+            if (!Heap.empty())
+            {
+                SiftDown(0);
+            }
+        }
+        if (!result.PDF.empty())
+        {
+            result.PDF.back().Prob = Run.Result();
+        }
+
+        result.remove_zero();
+
+        return result;
+    }
+
+    // Builds a distribution from an accumulator whose atoms already have
+    // distinct values so only a sort is needed.
+    template<typename ResultType, typename AccumulatorType>
+    static ResultType FromDistinctAtoms(AccumulatorType& Accumulator)
+    {
+        ResultType result{};
+        result.PDF = Accumulator.TakeAtoms();
+        result.Sort();
+        result.remove_zero();
 
         return result;
     }
 
     template<typename F>
-    std::invoke_result_t<F, ValueType> operator>>(const F& f) const
+    std::invoke_result_t<F, ValueType> operator>>(const F& f) const&
     {
         return this->AndThen(f);
     }
 
+    template<typename F>
+    std::invoke_result_t<F, ValueType> operator>>(const F& f) &&
+    {
+        return std::move(*this).AndThen(f);
+    }
+
+    // Starts a `TLazyDist<>` pipeline reading this distribution, which must
+    // outlive it.
+    auto Lazy() const&
+    {
+        auto Emitter = [this](const auto& Sink, ProbType& InDiscarded)
+        {
+            for (const auto& [Value, Prob] : PDF)
+            {
+                Sink(Value, Prob);
+            }
+            InDiscarded += Discarded;
+        };
+        return TLazyDist<ProbType, ValueType, decltype(Emitter)>(Emitter);
+    }
+
+    // Starts a `TLazyDist<>` pipeline that owns this distribution.
+    auto Lazy() &&
+    {
+        auto Emitter = [Source = std::move(*this)](const auto& Sink,
+                                                    ProbType& InDiscarded)
+        {
+            for (const auto& [Value, Prob] : Source.PDF)
+            {
+                Sink(Value, Prob);
+            }
+            InDiscarded += Source.Discarded;
+        };
+        return TLazyDist<ProbType, ValueType, decltype(Emitter)>(
+            std::move(Emitter));
+    }
+
     void check() const
     {
         double total = 0.0;
 
         for (const auto& [Value, Prob] : PDF)
         {
-            total += Prob;
+            total += static_cast<double>(Prob);
         }
 
         std::cout << "total = " << total << std::endl;
+        if (Discarded != 0)
+        {
+            std::cout << "discarded = " << Discarded << std::endl;
+        }
     }
 
     void dump() const
@@ -187,34 +1521,108 @@ template<typename ProbType, typename ValueType> struct TDist
         }
     }
 
-    const std::vector<TAtom<ProbType, ValueType>>& GetPDF() const
-    {
-        return PDF;
-    }
+    const TAtomArray<ProbType, ValueType>& GetPDF() const { return PDF; }
 
     auto begin() const { return PDF.begin(); }
 
     auto end() const { return PDF.end(); }
 
-    std::vector<TAtom<ProbType, ValueType>> PDF;
+    TAtomArray<ProbType, ValueType> PDF;
+
+    // Upper bound on the probability lost by approximations such as
+    // `Prune()` and `chop()`, in this distribution or the ones it was built
+    // from. Probabilities in `PDF` are each at most this much below their
+    // exact values. Carried through `TDist<>`'s own operations, `Max()`,
+    // `Min()` and `TLazyDist<>`, but lost on conversion to the dense and
+    // structure of arrays representations.
+    ProbType Discarded = 0;
 };
 
 template<typename ProbType, typename T, typename U>
 TDist<ProbType, AddResultType<T, U>> operator+(const T& t,
                                                const TDist<ProbType, U>& du)
 {
-    return du.Transform([t](const U& u) { return t + u; });
+    auto Add = [t](const U& u) { return t + u; };
+    if constexpr (COrderedArithmetic<T> && COrderedArithmetic<U>)
+    {
+        if constexpr (std::integral<AddResultType<T, U>>)
+        {
+            return du.TransformStrictlyMonotone(Add);
+        }
+        else
+        {
+            return du.TransformMonotone(Add);
+        }
+    }
+    else
+    {
+        return du.Transform(Add);
+    }
 }
 
 template<typename ProbType, typename T, typename U>
 TDist<ProbType, TimesResultType<T, U>> operator*(const T& t,
                                                  const TDist<ProbType, U>& du)
 {
-    return du.Transform([t](const U& u) { return t * u; });
+    auto Times = [t](const U& u) { return t * u; };
+    if constexpr (COrderedArithmetic<T> && COrderedArithmetic<U>)
+    {
+        if (t > 0)
+        {
+            if constexpr (std::integral<TimesResultType<T, U>>)
+            {
+                return du.TransformStrictlyMonotone(Times);
+            }
+            else
+            {
+                return du.TransformMonotone(Times);
+            }
+        }
+        else if (t < 0 && std::integral<TimesResultType<T, U>>)
+        {
+            return du.TransformInjective(Times);
+        }
+        else if (t == 0)
+        {
+            return du.TransformMonotone(Times);
+        }
+    }
+
+    return du.Transform(Times);
 }
 
 template<typename X> using TDDist = TDist<double, X>;
 
+// Combines `n >= 1` independent copies of `Dist` with `Combine` by repeated
+// squaring, using O(log n) calls.
+template<typename ProbType, typename ValueType, typename F>
+TDist<ProbType, ValueType> RepeatedSquaring(int n,
+                                            const TDist<ProbType, ValueType>& Dist,
+                                            const F& Combine)
+{
+    assert(n > 0);
+
+    TDist<ProbType, ValueType> Power = Dist;
+    TDist<ProbType, ValueType> result{};
+    bool                       bEmpty = true;
+    for (;;)
+    {
+        if (n & 1)
+        {
+            result = bEmpty ? Power : Combine(result, Power);
+            bEmpty = false;
+        }
+        n >>= 1;
+        if (n == 0)
+        {
+            break;
+        }
+        Power = Combine(Power, Power);
+    }
+
+    return result;
+}
+
 template<typename ProbType = double, typename T>
 std::ostream& operator<<(std::ostream& os, const TAtom<ProbType, T>& TAtom)
 {
@@ -230,18 +1638,32 @@ void SortAndCombine(std::vector<TAtom<ProbType, T>>& atoms)
               [](const TAtom<ProbType, T>& a, const TAtom<ProbType, T>& b)
               { return a.Value < b.Value; });
 
-    std::vector<TAtom<ProbType, T>> combined;
-    for (const auto& TAtom : atoms)
+    auto                      Out = atoms.begin();
+    TCompensatedSum<ProbType> Run;
+    for (auto In = atoms.begin(); In != atoms.end(); ++In)
     {
-        if (!combined.empty() && combined.back().Value == TAtom.Value)
+        if (Out != atoms.begin() && (Out - 1)->Value == In->Value)
         {
-            combined.back().Prob += TAtom.Prob;
+            Run.Add(In->Prob);
         }
         else
         {
-            combined.push_back(TAtom);
+            if (Out != atoms.begin())
+            {
+                (Out - 1)->Prob = Run.Result();
+            }
+            Run = TCompensatedSum<ProbType>{ In->Prob };
+            if (Out != In)
+            {
+                *Out = std::move(*In);
+            }
+            ++Out;
         }
     }
+    if (Out != atoms.begin())
+    {
+        (Out - 1)->Prob = Run.Result();
+    }
 
-    atoms = std::move(combined);
+    atoms.erase(Out, atoms.end());
 }
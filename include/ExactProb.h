@@ -0,0 +1,564 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Unsigned integer of any size, stored as little endian 32 bit limbs with no
+// leading zero limbs. Only used once an `FExactProb` outgrows 64 bits, so it
+// is written for simplicity rather than speed.
+class FBigCount
+{
+public:
+    FBigCount(std::uint64_t Value = 0)
+    {
+        for (; Value != 0; Value >>= 32)
+        {
+            Limbs.push_back(static_cast<std::uint32_t>(Value));
+        }
+    }
+
+    bool IsZero() const { return Limbs.empty(); }
+
+    bool FitsIn64() const { return Limbs.size() <= 2; }
+
+    std::uint64_t ToU64() const
+    {
+        assert(FitsIn64());
+        std::uint64_t Value = 0;
+        for (std::size_t K = Limbs.size(); K-- > 0;)
+        {
+            Value = Value << 32 | Limbs[K];
+        }
+        return Value;
+    }
+
+    std::size_t BitWidth() const
+    {
+        return Limbs.empty() ? 0
+                             : 32 * (Limbs.size() - 1) + std::bit_width(Limbs.back());
+    }
+
+    bool Bit(std::size_t I) const { return Limbs[I / 32] >> (I % 32) & 1; }
+
+    // Returns `Mantissa` in [0.5, 1) with this equal to about
+    // `Mantissa * 2^Exponent`, like `std::frexp()`, for values too large for
+    // a `double`.
+    double Frexp(int& Exponent) const
+    {
+        const std::size_t Width = BitWidth();
+        const std::size_t Low = Width > 64 ? Width - 64 : 0;
+        std::uint64_t     Top = 0;
+        for (std::size_t I = Width; I-- > Low;)
+        {
+            Top = Top << 1 | Bit(I);
+        }
+        const double Mantissa = std::frexp(static_cast<double>(Top), &Exponent);
+        Exponent += static_cast<int>(Low);
+        return Mantissa;
+    }
+
+    friend FBigCount operator+(const FBigCount& A, const FBigCount& B)
+    {
+        const auto& Long = A.Limbs.size() >= B.Limbs.size() ? A.Limbs : B.Limbs;
+        const auto& Short = A.Limbs.size() >= B.Limbs.size() ? B.Limbs : A.Limbs;
+
+        FBigCount     result;
+        std::uint64_t Carry = 0;
+        result.Limbs.resize(Long.size() + 1);
+        for (std::size_t K = 0; K < Long.size(); ++K)
+        {
+            Carry += std::uint64_t(Long[K]) + (K < Short.size() ? Short[K] : 0);
+            result.Limbs[K] = static_cast<std::uint32_t>(Carry);
+            Carry >>= 32;
+        }
+        result.Limbs[Long.size()] = static_cast<std::uint32_t>(Carry);
+        result.Trim();
+
+        return result;
+    }
+
+    // `A` must be at least `B`.
+    friend FBigCount operator-(const FBigCount& A, const FBigCount& B)
+    {
+        assert(A >= B);
+
+        FBigCount    result = A;
+        std::int64_t Borrow = 0;
+        for (std::size_t K = 0; K < result.Limbs.size(); ++K)
+        {
+            const std::int64_t Difference = std::int64_t(A.Limbs[K]) -
+                                            (K < B.Limbs.size() ? B.Limbs[K] : 0) -
+                                            Borrow;
+            Borrow = Difference < 0;
+            result.Limbs[K] =
+                static_cast<std::uint32_t>(Difference + (Borrow << 32));
+        }
+        result.Trim();
+
+        return result;
+    }
+
+    friend FBigCount operator*(const FBigCount& A, const FBigCount& B)
+    {
+        if (A.IsZero() || B.IsZero())
+        {
+            return FBigCount();
+        }
+
+        FBigCount result;
+        result.Limbs.assign(A.Limbs.size() + B.Limbs.size(), 0);
+        for (std::size_t I = 0; I < A.Limbs.size(); ++I)
+        {
+            std::uint64_t Carry = 0;
+            for (std::size_t J = 0; J < B.Limbs.size(); ++J)
+            {
+                Carry += std::uint64_t(A.Limbs[I]) * B.Limbs[J] + result.Limbs[I + J];
+                result.Limbs[I + J] = static_cast<std::uint32_t>(Carry);
+                Carry >>= 32;
+            }
+            result.Limbs[I + B.Limbs.size()] = static_cast<std::uint32_t>(Carry);
+        }
+        result.Trim();
+
+        return result;
+    }
+
+    friend bool operator==(const FBigCount& A, const FBigCount& B) = default;
+
+    friend std::strong_ordering operator<=>(const FBigCount& A, const FBigCount& B)
+    {
+        if (A.Limbs.size() != B.Limbs.size())
+        {
+            return A.Limbs.size() <=> B.Limbs.size();
+        }
+        for (std::size_t K = A.Limbs.size(); K-- > 0;)
+        {
+            if (A.Limbs[K] != B.Limbs[K])
+            {
+                return A.Limbs[K] <=> B.Limbs[K];
+            }
+        }
+        return std::strong_ordering::equal;
+    }
+
+    // Binary long division.
+    static void DivMod(const FBigCount& A, const FBigCount& B,
+                       FBigCount& Quotient, FBigCount& Remainder)
+    {
+        assert(!B.IsZero());
+
+        FBigCount Q;
+        FBigCount R;
+        Q.Limbs.assign(A.Limbs.size(), 0);
+        for (std::size_t I = A.BitWidth(); I-- > 0;)
+        {
+            R.ShiftLeftOne(A.Bit(I));
+            if (R >= B)
+            {
+                R = R - B;
+                Q.Limbs[I / 32] |= std::uint32_t(1) << (I % 32);
+            }
+        }
+        Q.Trim();
+        Quotient = std::move(Q);
+        Remainder = std::move(R);
+    }
+
+    friend FBigCount operator/(const FBigCount& A, const FBigCount& B)
+    {
+        FBigCount Quotient;
+        FBigCount Remainder;
+        DivMod(A, B, Quotient, Remainder);
+        return Quotient;
+    }
+
+    static FBigCount Gcd(FBigCount A, FBigCount B)
+    {
+        FBigCount Quotient;
+        FBigCount Remainder;
+        while (!B.IsZero())
+        {
+            DivMod(A, B, Quotient, Remainder);
+            A = std::move(B);
+            B = std::move(Remainder);
+        }
+        return A;
+    }
+
+    std::string ToString() const
+    {
+        if (IsZero())
+        {
+            return "0";
+        }
+
+        // Nine decimal digits at a time.
+        const FBigCount Billion(1000000000);
+        std::string     Digits;
+        FBigCount       Rest = *this;
+        FBigCount       Chunk;
+        while (!Rest.IsZero())
+        {
+            DivMod(Rest, Billion, Rest, Chunk);
+            std::string Part = std::to_string(Chunk.ToU64());
+            if (!Rest.IsZero())
+            {
+                Part.insert(0, 9 - Part.size(), '0');
+            }
+            Digits.insert(0, Part);
+        }
+        return Digits;
+    }
+
+private:
+    void Trim()
+    {
+        while (!Limbs.empty() && Limbs.back() == 0)
+        {
+            Limbs.pop_back();
+        }
+    }
+
+    void ShiftLeftOne(bool bLowBit)
+    {
+        std::uint32_t Carry = bLowBit;
+        for (auto& Limb : Limbs)
+        {
+            const std::uint32_t Next = Limb >> 31;
+            Limb = Limb << 1 | Carry;
+            Carry = Next;
+        }
+        if (Carry != 0)
+        {
+            Limbs.push_back(Carry);
+        }
+    }
+
+    std::vector<std::uint32_t> Limbs;
+};
+
+// An exact probability for models built from uniform dice, where every
+// probability is a count of equally likely paths over a product of die sizes:
+//
+//     TExactDist<int> Dist = Roll<FExactProb>(3, 6);
+//     Dist.dump();                  // prints 1/216, 1/72, ...
+//     TDDist<int> Approx = ToDouble(Dist);
+//
+// Probabilities are `Count / Denominator` and are never reduced, so atoms of
+// one distribution keep sharing a denominator and adding them, as `Merge()`
+// and convolution do, is a single integer add. Mixed denominators are brought
+// to their least common multiple. Both numbers are `uint64_t` until a result
+// overflows, then widen to an `FBigCount` on the heap.
+class FExactProb
+{
+public:
+    FExactProb() = default;
+
+    template<std::integral IntType>
+    FExactProb(IntType InCount) : Count(static_cast<std::uint64_t>(InCount))
+    {
+        if constexpr (std::is_signed_v<IntType>)
+        {
+            assert(InCount >= 0);
+        }
+    }
+
+    FExactProb(std::uint64_t InCount, std::uint64_t InDenominator)
+        : Count(InCount), Denominator(InDenominator)
+    {
+        assert(InDenominator != 0);
+    }
+
+    FExactProb(const FBigCount& InCount, const FBigCount& InDenominator)
+    {
+        assert(!InDenominator.IsZero());
+        if (InCount.FitsIn64() && InDenominator.FitsIn64())
+        {
+            Count = InCount.ToU64();
+            Denominator = InDenominator.ToU64();
+        }
+        else
+        {
+            Big = std::make_unique<FBigFraction>(InCount, InDenominator);
+        }
+    }
+
+    FExactProb(const FExactProb& Other)
+        : Count(Other.Count),
+          Denominator(Other.Denominator),
+          Big(Other.Big ? std::make_unique<FBigFraction>(*Other.Big) : nullptr)
+    {
+    }
+
+    FExactProb(FExactProb&& Other) noexcept = default;
+
+    FExactProb& operator=(const FExactProb& Other)
+    {
+        if (this != &Other)
+        {
+            *this = FExactProb(Other);
+        }
+        return *this;
+    }
+
+    FExactProb& operator=(FExactProb&& Other) noexcept = default;
+
+    FBigCount GetCount() const { return Big ? Big->Count : FBigCount(Count); }
+
+    FBigCount GetDenominator() const
+    {
+        return Big ? Big->Denominator : FBigCount(Denominator);
+    }
+
+    // Whether the count or denominator has outgrown 64 bits.
+    bool IsBig() const { return Big != nullptr; }
+
+    double ToDouble() const
+    {
+        if (!Big)
+        {
+            return static_cast<double>(Count) / static_cast<double>(Denominator);
+        }
+        int          CountExponent;
+        int          DenominatorExponent;
+        const double CountMantissa = Big->Count.Frexp(CountExponent);
+        const double DenominatorMantissa =
+            Big->Denominator.Frexp(DenominatorExponent);
+        return std::ldexp(CountMantissa / DenominatorMantissa,
+                          CountExponent - DenominatorExponent);
+    }
+
+    explicit operator double() const { return ToDouble(); }
+
+    // The fraction in lowest terms, such as "1/6".
+    std::string ToString() const
+    {
+        const FBigCount C = GetCount();
+        const FBigCount D = GetDenominator();
+        const FBigCount Divisor = C.IsZero() ? D : FBigCount::Gcd(C, D);
+        const FBigCount ReducedDenominator = D / Divisor;
+        return (C / Divisor).ToString() +
+               (ReducedDenominator == FBigCount(1)
+                    ? std::string()
+                    : "/" + ReducedDenominator.ToString());
+    }
+
+    FExactProb& operator+=(const FExactProb& Other)
+    {
+        std::uint64_t Sum;
+        if (!Big && !Other.Big && Denominator == Other.Denominator &&
+            AddExact(Count, Other.Count, Sum))
+        {
+            Count = Sum;
+            return *this;
+        }
+        return *this = *this + Other;
+    }
+
+    FExactProb& operator-=(const FExactProb& Other) { return *this = *this - Other; }
+
+    FExactProb& operator*=(const FExactProb& Other) { return *this = *this * Other; }
+
+    FExactProb& operator/=(const FExactProb& Other) { return *this = *this / Other; }
+
+    friend FExactProb operator+(const FExactProb& A, const FExactProb& B)
+    {
+        return Combine(A, B, false);
+    }
+
+    // `A` must be at least `B`.
+    friend FExactProb operator-(const FExactProb& A, const FExactProb& B)
+    {
+        return Combine(A, B, true);
+    }
+
+    friend FExactProb operator*(const FExactProb& A, const FExactProb& B)
+    {
+        std::uint64_t Count;
+        std::uint64_t Denominator;
+        if (!A.Big && !B.Big && MultiplyExact(A.Count, B.Count, Count) &&
+            MultiplyExact(A.Denominator, B.Denominator, Denominator))
+        {
+            return FExactProb(Count, Denominator);
+        }
+        return FExactProb(A.GetCount() * B.GetCount(),
+                          A.GetDenominator() * B.GetDenominator());
+    }
+
+    friend FExactProb operator/(const FExactProb& A, const FExactProb& B)
+    {
+        assert(B != 0);
+        std::uint64_t Count;
+        std::uint64_t Denominator;
+        if (!A.Big && !B.Big && MultiplyExact(A.Count, B.Denominator, Count) &&
+            MultiplyExact(A.Denominator, B.Count, Denominator))
+        {
+            return FExactProb(Count, Denominator);
+        }
+        return FExactProb(A.GetCount() * B.GetDenominator(),
+                          A.GetDenominator() * B.GetCount());
+    }
+
+    friend bool operator==(const FExactProb& A, const FExactProb& B)
+    {
+        return A <=> B == 0;
+    }
+
+    friend std::strong_ordering operator<=>(const FExactProb& A, const FExactProb& B)
+    {
+        if (!A.Big && !B.Big)
+        {
+            std::uint64_t Left;
+            std::uint64_t Right;
+            if (A.Denominator == B.Denominator)
+            {
+                return A.Count <=> B.Count;
+            }
+            if (MultiplyExact(A.Count, B.Denominator, Left) &&
+                MultiplyExact(B.Count, A.Denominator, Right))
+            {
+                return Left <=> Right;
+            }
+        }
+        return A.GetCount() * B.GetDenominator() <=>
+               B.GetCount() * A.GetDenominator();
+    }
+
+    // Compares with thresholds such as `FPruning::Threshold`.
+    template<std::floating_point FloatType>
+    friend bool operator==(const FExactProb& A, FloatType B)
+    {
+        return A.ToDouble() == B;
+    }
+
+    template<std::floating_point FloatType>
+    friend std::partial_ordering operator<=>(const FExactProb& A, FloatType B)
+    {
+        return A.ToDouble() <=> static_cast<double>(B);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const FExactProb& Prob)
+    {
+        return os << Prob.ToString();
+    }
+
+private:
+    struct FBigFraction
+    {
+        FBigCount Count;
+        FBigCount Denominator;
+    };
+
+    static bool AddExact(std::uint64_t A, std::uint64_t B, std::uint64_t& Sum)
+    {
+        if (A > std::numeric_limits<std::uint64_t>::max() - B)
+        {
+            return false;
+        }
+        Sum = A + B;
+        return true;
+    }
+
+    static bool MultiplyExact(std::uint64_t A, std::uint64_t B,
+                              std::uint64_t& Product)
+    {
+#if defined(__SIZEOF_INT128__)
+        const unsigned __int128 Wide = static_cast<unsigned __int128>(A) * B;
+        Product = static_cast<std::uint64_t>(Wide);
+        return (Wide >> 64) == 0;
+#else
+        if (A != 0 && B > std::numeric_limits<std::uint64_t>::max() / A)
+        {
+            return false;
+        }
+        Product = A * B;
+        return true;
+#endif
+    }
+
+    // `A + B`, or `A - B` if `bSubtract`, over the least common multiple of
+    // their denominators.
+    static FExactProb Combine(const FExactProb& A, const FExactProb& B,
+                              bool bSubtract)
+    {
+        if (!A.Big && !B.Big)
+        {
+            std::uint64_t ScaleA = 1;
+            std::uint64_t ScaleB = 1;
+            std::uint64_t Denominator = A.Denominator;
+            if (A.Denominator != B.Denominator)
+            {
+                const std::uint64_t Divisor = std::gcd(A.Denominator, B.Denominator);
+                ScaleA = B.Denominator / Divisor;
+                ScaleB = A.Denominator / Divisor;
+            }
+            std::uint64_t CountA;
+            std::uint64_t CountB;
+            if (MultiplyExact(A.Denominator, ScaleA, Denominator) &&
+                MultiplyExact(A.Count, ScaleA, CountA) &&
+                MultiplyExact(B.Count, ScaleB, CountB))
+            {
+                if (bSubtract)
+                {
+                    assert(CountA >= CountB);
+                    return FExactProb(CountA - CountB, Denominator);
+                }
+                std::uint64_t Count;
+                if (AddExact(CountA, CountB, Count))
+                {
+                    return FExactProb(Count, Denominator);
+                }
+            }
+        }
+
+        const FBigCount DenominatorA = A.GetDenominator();
+        const FBigCount DenominatorB = B.GetDenominator();
+        FBigCount       ScaleA(1);
+        FBigCount       ScaleB(1);
+        if (DenominatorA != DenominatorB)
+        {
+            const FBigCount Divisor = FBigCount::Gcd(DenominatorA, DenominatorB);
+            ScaleA = DenominatorB / Divisor;
+            ScaleB = DenominatorA / Divisor;
+        }
+        const FBigCount CountA = A.GetCount() * ScaleA;
+        const FBigCount CountB = B.GetCount() * ScaleB;
+        return FExactProb(bSubtract ? CountA - CountB : CountA + CountB,
+                          DenominatorA * ScaleA);
+    }
+
+    std::uint64_t                 Count = 0;
+    std::uint64_t                 Denominator = 1;
+    std::unique_ptr<FBigFraction> Big;
+};
+
+template<typename X> using TExactDist = TDist<FExactProb, X>;
+
+// The same distribution with `double` probabilities, for reporting or for
+// continuing with operations that need them.
+template<typename ValueType>
+TDist<double, ValueType> ToDouble(const TDist<FExactProb, ValueType>& Dist)
+{
+    TDist<double, ValueType> result{};
+    result.PDF.reserve(Dist.PDF.size());
+    for (const auto& [Value, Prob] : Dist.PDF)
+    {
+        result.PDF.push_back(TAtom<double, ValueType>{ Value, Prob.ToDouble() });
+    }
+    result.Discarded = Dist.Discarded.ToDouble();
+
+    return result;
+}
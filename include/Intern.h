@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+
+template<typename ProbType, typename ValueType>
+using TDistHandle = std::shared_ptr<const TDist<ProbType, ValueType>>;
+
+// Hash-consing for distributions that depend only on a few arguments, such
+// as `Roll(6)` or `Roll(20) >= ToHit` rebuilt in every call to a
+// continuation. Returns a shared immutable copy of `Make(Args...)`, built the
+// first time each set of arguments is seen and reused after that:
+//
+//     Interned([](int ToHit) { return Roll(20) >= ToHit; }, ToHit)
+//
+// `Make` must be a lambda with no captures, whose type identifies the table,
+// and must be a pure function of its arguments, which must be ordered by
+// `<`. Each thread has its own tables so lookups take no locks. Entries live
+// until the thread exits and are allocated on the heap even inside an
+// `FArenaScope`.
+template<typename MakeType, typename... ArgTypes>
+auto Interned(const MakeType& Make, const ArgTypes&... Args)
+{
+    static_assert(std::is_empty_v<MakeType>,
+                  "Interned() needs a lambda with no captures");
+
+    using DistType = std::invoke_result_t<MakeType, const ArgTypes&...>;
+
+    thread_local std::map<std::tuple<ArgTypes...>, std::shared_ptr<const DistType>>
+        Table;
+
+    std::tuple<ArgTypes...> Key(Args...);
+    auto                    Entry = Table.lower_bound(Key);
+    if (Entry != Table.end() && !(Key < Entry->first))
+    {
+        return Entry->second;
+    }
+
+    // Built before inserting, so a `Make` that throws leaves no entry behind.
+    // `Make` may itself use this table, which keeps `Entry` valid as a hint.
+    std::shared_ptr<const DistType> Dist;
+    {
+        FDistResourceScope Heap(std::pmr::new_delete_resource());
+        Dist = std::make_shared<const DistType>(Make(Args...));
+    }
+
+    return Table.emplace_hint(Entry, std::move(Key), std::move(Dist))->second;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// A chain of `AndThen()` and `Transform()` stages recorded without being
+// evaluated, as returned by `TDist<>::Lazy()`. `Collect()` pushes each source
+// atom through every stage in turn and canonicalises once at the end, so no
+// intermediate distribution is built or sorted and adjacent `Transform()`s
+// become one call per atom. The stages are copied into the pipeline but a
+// pipeline started from an lvalue refers to that distribution.
+//
+// Without merging, atoms with equal values are carried separately through
+// the later stages, multiplying the work when stages collapse many values
+// together. `Merge()` is an explicit checkpoint that canonicalises the atoms
+// produced so far before continuing.
+//
+// `EmitterType` is called with a sink and an accumulator for discarded
+// probability. It calls the sink with the value and probability of every
+// atom the pipeline produces and adds the `Discarded` probability of the
+// distributions it reads, weighted by how likely they are to be reached.
+template<typename ProbType, typename ValueType, typename EmitterType>
+class TLazyDist
+{
+public:
+    explicit TLazyDist(EmitterType InEmitter) : Emitter(std::move(InEmitter)) {}
+
+    template<typename F> auto Transform(const F& f) const
+    {
+        using ResultValueType = std::invoke_result_t<F, ValueType>;
+
+        return MakeLazy<ResultValueType>(
+            [Emitter = Emitter, f](const auto& Sink, ProbType& Discarded)
+            {
+                Emitter(
+                    [&](auto&& Value, ProbType Prob)
+                    { Sink(f(std::forward<decltype(Value)>(Value)), Prob); },
+                    Discarded);
+            });
+    }
+
+    template<typename F> auto AndThen(const F& f) const
+    {
+        using ResultType = std::invoke_result_t<F, ValueType>;
+        static_assert(
+            std::same_as<typename TDistTypes<ResultType>::Prob, ProbType>);
+
+        return MakeLazy<typename TDistTypes<ResultType>::Value>(
+            [Emitter = Emitter, f](const auto& Sink, ProbType& Discarded)
+            {
+                Emitter(
+                    [&](auto&& Value, ProbType Prob)
+                    {
+                        auto fx = f(std::forward<decltype(Value)>(Value));
+                        for (auto& r : fx.PDF)
+                        {
+                            Sink(std::move(r.Value), Prob * r.Prob);
+                        }
+                        Discarded += Prob * fx.Discarded;
+                    },
+                    Discarded);
+            });
+    }
+
+    // Materialises and canonicalises the pipeline so far, then continues
+    // lazily from the result.
+    auto Merge(EMergeStrategy Strategy = EMergeStrategy::Sort) const
+    {
+        return Collect(Strategy).Lazy();
+    }
+
+    TDist<ProbType, ValueType>
+    Collect(EMergeStrategy Strategy = EMergeStrategy::Sort) const
+    {
+        if constexpr (CHashable<ValueType>)
+        {
+            if (Strategy == EMergeStrategy::Hash)
+            {
+                TAtomAccumulator<ProbType, ValueType> Accumulator;
+                ProbType                              Discarded = 0;
+                Emitter(
+                    [&Accumulator](auto&& Value, ProbType Prob)
+                    {
+                        Accumulator.Add(std::forward<decltype(Value)>(Value),
+                                        Prob);
+                    },
+                    Discarded);
+
+                auto result =
+                    TDist<ProbType, ValueType>::template FromDistinctAtoms<
+                        TDist<ProbType, ValueType>>(Accumulator);
+                result.Discarded = Discarded;
+                return result;
+            }
+        }
+
+        TDist<ProbType, ValueType> result{};
+        Emitter(
+            [&result](auto&& Value, ProbType Prob)
+            {
+                result.PDF.push_back(TAtom<ProbType, ValueType>{
+                    std::forward<decltype(Value)>(Value), Prob });
+            },
+            result.Discarded);
+        result.canonicalise();
+
+        return result;
+    }
+
+private:
+    template<typename ResultValueType, typename ResultEmitterType>
+    static TLazyDist<ProbType, ResultValueType, ResultEmitterType>
+    MakeLazy(ResultEmitterType ResultEmitter)
+    {
+        return TLazyDist<ProbType, ResultValueType, ResultEmitterType>(
+            std::move(ResultEmitter));
+    }
+
+    EmitterType Emitter;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+struct FMemoStats
+{
+    std::size_t Hits = 0;
+    std::size_t Misses = 0;
+    std::size_t Evictions = 0;
+};
+
+// A continuation that remembers the distributions `f` has returned, for loops
+// where the same states come back step after step:
+//
+//     auto Step = Memo<FState>(f);
+//     for (int T = 0; T < N; ++T)
+//     {
+//         Dist = std::move(Dist).AndThen(Step);
+//     }
+//
+// `f` must be a pure function of the state. At most `Capacity` results are
+// kept, and once full the least recently used one is dropped. States are
+// found by hash when `TValueHash<>` supports them and by `<` otherwise.
+// Copies of a `TMemo<>` share one cache, so `Stats()` on the original counts
+// calls made through copies held by `iterate()` or a lazy pipeline. The cache
+// takes no locks and must not be used from several threads at once, for
+// example by the `FParallel` overload of `AndThen()`.
+//
+// Every call returns a copy of the cached distribution, which is cheap when
+// the continuation only produces a few atoms but means there is nothing to
+// gain when `f` itself is about as cheap as copying its result.
+template<typename KeyType, typename F> class TMemo
+{
+public:
+    using ResultType = std::invoke_result_t<const F&, const KeyType&>;
+
+    TMemo(F Inf, std::size_t Capacity)
+        : f(std::move(Inf)), Cache(std::make_shared<FCache>())
+    {
+        Cache->Capacity = Capacity;
+    }
+
+    ResultType operator()(const KeyType& Key) const
+    {
+        FCache& S = *Cache;
+
+        if (auto Found = S.Index.find(Key); Found != S.Index.end())
+        {
+            ++S.Stats.Hits;
+            S.Entries.splice(S.Entries.begin(), S.Entries, Found->second);
+            return Found->second->second;
+        }
+
+        ++S.Stats.Misses;
+        if (S.Capacity == 0)
+        {
+            return f(Key);
+        }
+
+        // Cached results are kept on the heap so they survive an
+        // `FArenaScope` release, as in `iterate()`. Nothing is evicted until
+        // `f` has returned, so an `f` that throws loses no entries and one
+        // that calls this memo for other keys can't push it past `Capacity`.
+        ResultType Result = [this, &Key]
+        {
+            FDistResourceScope Heap(std::pmr::new_delete_resource());
+            return f(Key);
+        }();
+        if (auto Found = S.Index.find(Key); Found != S.Index.end())
+        {
+            S.Entries.splice(S.Entries.begin(), S.Entries, Found->second);
+            return Found->second->second;
+        }
+
+        S.Entries.emplace_front(Key, std::move(Result));
+        S.Index.emplace(S.Entries.front().first, S.Entries.begin());
+        while (S.Entries.size() > S.Capacity)
+        {
+            ++S.Stats.Evictions;
+            S.Index.erase(S.Entries.back().first);
+            S.Entries.pop_back();
+        }
+
+        return S.Entries.front().second;
+    }
+
+    const FMemoStats& Stats() const { return Cache->Stats; }
+
+    std::size_t size() const { return Cache->Entries.size(); }
+
+    void clear() const
+    {
+        Cache->Index.clear();
+        Cache->Entries.clear();
+    }
+
+private:
+    using FEntryList = std::list<std::pair<KeyType, ResultType>>;
+
+    using FIndex = std::conditional_t<
+        CHashable<KeyType>,
+        std::unordered_map<KeyType,
+                           typename FEntryList::iterator,
+                           TValueHash<KeyType>>,
+        std::map<KeyType, typename FEntryList::iterator>>;
+
+    // Most recently used first.
+    struct FCache
+    {
+        std::size_t Capacity = 0;
+        FEntryList  Entries;
+        FIndex      Index;
+        FMemoStats  Stats;
+    };
+
+    F                       f;
+    std::shared_ptr<FCache> Cache;
+};
+
+template<typename KeyType, typename F>
+TMemo<KeyType, F> Memo(F f, std::size_t Capacity = 1 << 16)
+{
+    return TMemo<KeyType, F>(std::move(f), Capacity);
+}
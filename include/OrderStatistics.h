@@ -0,0 +1,254 @@
+#pragma once
+
+// Maxima and minima of independent random variables. Rather than enumerating
+// every pair of values these sweep the sorted supports once, using
+//
+//     P(max(X, Y) = v) = P(X = v) P(Y <= v) + P(X < v) P(Y = v)
+//
+// which is the difference of the product of the CDFs written so that no
+// probabilities close to one are subtracted. Minima use survival functions in
+// the same way.
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType> Max(const TDist<ProbType, ValueType>& A,
+                               const TDist<ProbType, ValueType>& B)
+{
+    TDist<ProbType, ValueType> result{};
+    result.Discarded = A.Discarded + B.Discarded;
+    result.PDF.reserve(A.PDF.size() + B.PDF.size());
+
+    // Probabilities of being strictly below the current value.
+    ProbType    BelowA = 0;
+    ProbType    BelowB = 0;
+    std::size_t I = 0;
+    std::size_t J = 0;
+    while (I < A.PDF.size() || J < B.PDF.size())
+    {
+        const bool bTakeA =
+            J == B.PDF.size() ||
+            (I < A.PDF.size() && !(B.PDF[J].Value < A.PDF[I].Value));
+        const bool bTakeB =
+            I == A.PDF.size() ||
+            (J < B.PDF.size() && !(A.PDF[I].Value < B.PDF[J].Value));
+
+        const ValueType& Value = bTakeA ? A.PDF[I].Value : B.PDF[J].Value;
+        const ProbType   ProbA = bTakeA ? A.PDF[I++].Prob : ProbType(0);
+        const ProbType   ProbB = bTakeB ? B.PDF[J++].Prob : ProbType(0);
+
+        result.PDF.push_back(TAtom<ProbType, ValueType>{
+            Value, ProbA * (BelowB + ProbB) + BelowA * ProbB });
+        BelowA += ProbA;
+        BelowB += ProbB;
+    }
+
+    result.remove_zero();
+
+    return result;
+}
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType> Min(const TDist<ProbType, ValueType>& A,
+                               const TDist<ProbType, ValueType>& B)
+{
+    TDist<ProbType, ValueType> result{};
+    result.Discarded = A.Discarded + B.Discarded;
+    result.PDF.reserve(A.PDF.size() + B.PDF.size());
+
+    // Probabilities of being strictly above the current value, sweeping down
+    // from the largest values.
+    ProbType    AboveA = 0;
+    ProbType    AboveB = 0;
+    std::size_t I = A.PDF.size();
+    std::size_t J = B.PDF.size();
+    while (I > 0 || J > 0)
+    {
+        const bool bTakeA =
+            J == 0 || (I > 0 && !(A.PDF[I - 1].Value < B.PDF[J - 1].Value));
+        const bool bTakeB =
+            I == 0 || (J > 0 && !(B.PDF[J - 1].Value < A.PDF[I - 1].Value));
+
+        const ValueType& Value =
+            bTakeA ? A.PDF[I - 1].Value : B.PDF[J - 1].Value;
+        const ProbType ProbA = bTakeA ? A.PDF[--I].Prob : ProbType(0);
+        const ProbType ProbB = bTakeB ? B.PDF[--J].Prob : ProbType(0);
+
+        result.PDF.push_back(TAtom<ProbType, ValueType>{
+            Value, ProbA * (AboveB + ProbB) + AboveA * ProbB });
+        AboveA += ProbA;
+        AboveB += ProbB;
+    }
+
+    std::reverse(result.PDF.begin(), result.PDF.end());
+    result.remove_zero();
+
+    return result;
+}
+
+// Maximum of `n` independent copies of `Dist`.
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType> MaxOf(int n, const TDist<ProbType, ValueType>& Dist)
+{
+    return RepeatedSquaring(n, Dist, [](const auto& A, const auto& B)
+                            { return Max(A, B); });
+}
+
+// Minimum of `n` independent copies of `Dist`.
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType> MinOf(int n, const TDist<ProbType, ValueType>& Dist)
+{
+    return RepeatedSquaring(n, Dist, [](const auto& A, const auto& B)
+                            { return Min(A, B); });
+}
+
+// Dynamic programming over the faces of `Dist`, best first by `Compare`, for
+// the best `Keep` of `n` independent rolls. The state after visiting a face
+// is the number of dice showing that face or better together with the kept
+// values so far, weighted by the multinomial count of ways to get there.
+// Once `Keep` dice are accounted for the remaining dice must all show worse
+// faces, which happens with probability P(worse)^remaining, so the kept
+// values are final. `Append(State, Face, Count)` adds `Count` copies of
+// `Face` to a kept state. Runs in time polynomial in `n`, `Keep` and the
+// number of faces without enumerating rolls.
+template<typename ProbType, typename ValueType, typename StateType,
+         typename Compare, typename AppendType>
+TDist<ProbType, StateType> KeepBest(int n, int Keep,
+                                    const TDist<ProbType, ValueType>& Dist,
+                                    const Compare& compare,
+                                    const AppendType& Append)
+{
+    const int Kept = std::clamp(Keep, 0, std::max(n, 0));
+    if (Kept == 0)
+    {
+        return TDist<ProbType, StateType>{ { StateType{}, ProbType(1) } };
+    }
+
+    std::vector<TAtom<ProbType, ValueType>> Faces(Dist.PDF.begin(),
+                                                  Dist.PDF.end());
+    std::stable_sort(Faces.begin(),
+                     Faces.end(),
+                     [&compare](const auto& A, const auto& B)
+                     { return compare(A.Value, B.Value); });
+
+    // Binomial[m][c] is m choose c.
+    std::vector<std::vector<ProbType>> Binomial(n + 1);
+    for (int M = 0; M <= n; ++M)
+    {
+        Binomial[M].assign(M + 1, ProbType(1));
+        for (int C = 1; C < M; ++C)
+        {
+            Binomial[M][C] = Binomial[M - 1][C - 1] + Binomial[M - 1][C];
+        }
+    }
+
+    // Worse[t] is the probability of a face worse than `Faces[t]`.
+    std::vector<ProbType> Worse(Faces.size(), 0);
+    for (std::size_t T = Faces.size(); T-- > 1;)
+    {
+        Worse[T - 1] = Worse[T] + Faces[T].Prob;
+    }
+
+    // Level[a] maps kept states to weights for `a < Kept` dice assigned.
+    std::vector<std::map<StateType, ProbType>> Level(Kept);
+    Level[0][StateType{}] = 1;
+    std::vector<TAtom<ProbType, StateType>> Finished;
+    std::vector<ProbType>                   FacePowers(n + 1);
+    std::vector<ProbType>                   WorsePowers(n + 1);
+
+    for (std::size_t T = 0; T < Faces.size(); ++T)
+    {
+        const auto& [Face, Prob] = Faces[T];
+        FacePowers[0] = WorsePowers[0] = 1;
+        for (int C = 1; C <= n; ++C)
+        {
+            FacePowers[C] = FacePowers[C - 1] * Prob;
+            WorsePowers[C] = WorsePowers[C - 1] * Worse[T];
+        }
+
+        std::vector<std::map<StateType, ProbType>> NextLevel(Kept);
+        for (int Assigned = 0; Assigned < Kept; ++Assigned)
+        {
+            const int Remaining = n - Assigned;
+            for (const auto& [State, Weight] : Level[Assigned])
+            {
+                NextLevel[Assigned][State] += Weight;
+
+                for (int C = 1; C <= Remaining; ++C)
+                {
+                    const ProbType Ways = Weight * Binomial[Remaining][C] *
+                                          FacePowers[C];
+                    if (Assigned + C < Kept)
+                    {
+                        NextLevel[Assigned + C][Append(State, Face, C)] += Ways;
+                    }
+                    else
+                    {
+                        Finished.push_back(TAtom<ProbType, StateType>{
+                            Append(State, Face, Kept - Assigned),
+                            Ways * WorsePowers[Remaining - C] });
+                    }
+                }
+            }
+        }
+
+        Level = std::move(NextLevel);
+    }
+
+    return TDist<ProbType, StateType>(Finished);
+}
+
+// The best `Keep` of `n` independent rolls of `Dist` as a vector sorted
+// best first, where `Compare` orders values best first. The default keeps
+// the highest rolls.
+template<typename ProbType, typename ValueType,
+         typename Compare = std::greater<ValueType>>
+TDist<ProbType, std::vector<ValueType>>
+KeepHighest(int n, int Keep, const TDist<ProbType, ValueType>& Dist,
+            const Compare& compare = Compare())
+{
+    return KeepBest<ProbType, ValueType, std::vector<ValueType>>(
+        n,
+        Keep,
+        Dist,
+        compare,
+        [](std::vector<ValueType> State, const ValueType& Face, int Count)
+        {
+            State.insert(State.end(), Count, Face);
+            return State;
+        });
+}
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, std::vector<ValueType>>
+KeepLowest(int n, int Keep, const TDist<ProbType, ValueType>& Dist)
+{
+    return KeepHighest(n, Keep, Dist, std::less<ValueType>());
+}
+
+// Sum of the best `Keep` of `n` independent rolls of `Dist`.
+template<typename ProbType, typename ValueType,
+         typename Compare = std::greater<ValueType>>
+TDist<ProbType, ValueType>
+KeepHighestSum(int n, int Keep, const TDist<ProbType, ValueType>& Dist,
+               const Compare& compare = Compare())
+{
+    return KeepBest<ProbType, ValueType, ValueType>(
+        n,
+        Keep,
+        Dist,
+        compare,
+        [](ValueType State, const ValueType& Face, int Count)
+        {
+            for (int I = 0; I < Count; ++I)
+            {
+                State = State + Face;
+            }
+            return State;
+        });
+}
+
+template<typename ProbType, typename ValueType>
+TDist<ProbType, ValueType>
+KeepLowestSum(int n, int Keep, const TDist<ProbType, ValueType>& Dist)
+{
+    return KeepHighestSum(n, Keep, Dist, std::less<ValueType>());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Execution policy selecting the multi-threaded overloads of `AndThen()` and
+// `Transform()`:
+//
+//     Dist.AndThen(Parallel, f)
+//     Dist.AndThen(FParallel{ 8 }, f)
+//
+// The function passed in is called concurrently from several threads so it
+// must not modify shared state. A `NumThreads` of zero uses one thread per
+// hardware thread.
+struct FParallel
+{
+    unsigned NumThreads = 0;
+};
+
+inline constexpr FParallel Parallel{};
+
+// Number of input atoms handled by each task. The partition depends only on
+// the size of the input, never on the number of threads, so the partial
+// results and the order in which they are summed are the same however many
+// threads run them. This is what makes parallel results bit-reproducible.
+inline constexpr std::size_t ParallelChunkSize = 1024;
+
+inline unsigned ResolveNumThreads(const FParallel& Policy)
+{
+    if (Policy.NumThreads != 0)
+    {
+        return Policy.NumThreads;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Calls `Task(i)` for each `i` in `[0, NumTasks)` using up to `NumThreads`
+// threads, including the calling thread. If any task throws, the remaining
+// tasks are skipped and the first exception is rethrown once every thread has
+// stopped.
+template<typename F>
+void ParallelFor(std::size_t NumTasks, unsigned NumThreads, const F& Task)
+{
+    const std::size_t NumWorkers =
+        std::min<std::size_t>(std::max(1u, NumThreads), NumTasks);
+    if (NumWorkers <= 1)
+    {
+        for (std::size_t I = 0; I < NumTasks; ++I)
+        {
+            Task(I);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> Next = 0;
+    std::exception_ptr       Error;
+    std::mutex               ErrorMutex;
+
+    auto Work = [&]
+    {
+        for (std::size_t I = Next++; I < NumTasks; I = Next++)
+        {
+            try
+            {
+                Task(I);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> Lock(ErrorMutex);
+                if (!Error)
+                {
+                    Error = std::current_exception();
+                }
+                Next = NumTasks;
+            }
+        }
+    };
+
+    std::vector<std::thread> Workers;
+    Workers.reserve(NumWorkers - 1);
+    for (std::size_t I = 1; I < NumWorkers; ++I)
+    {
+        Workers.emplace_back(Work);
+    }
+    Work();
+    for (std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+
+    if (Error)
+    {
+        std::rethrow_exception(Error);
+    }
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Loops over contiguous arrays of probabilities, used by `TSoADist<>`. The
+// `double` kernels use AVX-512 or AVX2 when the compiler targets them (build
+// with `-DCHANCESCRIPT_NATIVE=ON` to target the host CPU) and otherwise, like
+// every other probability type, fall back to plain loops.
+//
+// The vector sums add in a different order from the scalar loop so results
+// can differ from it in the last bits.
+
+template<typename ProbType>
+void ScaleProbs(ProbType* Probs, std::size_t Count, ProbType Scale)
+{
+    for (std::size_t I = 0; I < Count; ++I)
+    {
+        Probs[I] *= Scale;
+    }
+}
+
+template<typename ProbType>
+ProbType SumProbs(const ProbType* Probs, std::size_t Count)
+{
+    ProbType Total = 0;
+    for (std::size_t I = 0; I < Count; ++I)
+    {
+        Total += Probs[I];
+    }
+    return Total;
+}
+
+// Index of the first probability from `Begin` whose magnitude is below
+// `Threshold`, or `Count` if there is none. A `Threshold` of zero is never
+// met so zeros are found with `FindFirstZeroProb()`.
+template<typename ProbType>
+std::size_t FindFirstSmallProb(const ProbType* Probs, std::size_t Begin,
+                               std::size_t Count, ProbType Threshold)
+{
+    for (std::size_t I = Begin; I < Count; ++I)
+    {
+        if (std::abs(Probs[I]) < Threshold)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+template<typename ProbType>
+std::size_t FindFirstZeroProb(const ProbType* Probs, std::size_t Begin,
+                              std::size_t Count)
+{
+    for (std::size_t I = Begin; I < Count; ++I)
+    {
+        if (Probs[I] == 0)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+#if defined(__AVX512F__)
+
+template<>
+inline void ScaleProbs<double>(double* Probs, std::size_t Count, double Scale)
+{
+    const __m512d Factor = _mm512_set1_pd(Scale);
+    std::size_t   I = 0;
+    for (; I + 8 <= Count; I += 8)
+    {
+        _mm512_storeu_pd(Probs + I,
+                         _mm512_mul_pd(_mm512_loadu_pd(Probs + I), Factor));
+    }
+    const __mmask8 Tail = static_cast<__mmask8>((1u << (Count - I)) - 1);
+    _mm512_mask_storeu_pd(
+        Probs + I, Tail, _mm512_mul_pd(_mm512_maskz_loadu_pd(Tail, Probs + I), Factor));
+}
+
+template<>
+inline double SumProbs<double>(const double* Probs, std::size_t Count)
+{
+    __m512d     Total = _mm512_setzero_pd();
+    std::size_t I = 0;
+    for (; I + 8 <= Count; I += 8)
+    {
+        Total = _mm512_add_pd(Total, _mm512_loadu_pd(Probs + I));
+    }
+    const __mmask8 Tail = static_cast<__mmask8>((1u << (Count - I)) - 1);
+    Total = _mm512_add_pd(Total, _mm512_maskz_loadu_pd(Tail, Probs + I));
+    return _mm512_reduce_add_pd(Total);
+}
+
+template<>
+inline std::size_t FindFirstSmallProb<double>(const double* Probs,
+                                              std::size_t   Begin,
+                                              std::size_t   Count,
+                                              double        Threshold)
+{
+    const __m512d Limit = _mm512_set1_pd(Threshold);
+    std::size_t   I = Begin;
+    for (; I + 8 <= Count; I += 8)
+    {
+        const __mmask8 Small = _mm512_cmp_pd_mask(
+            _mm512_abs_pd(_mm512_loadu_pd(Probs + I)), Limit, _CMP_LT_OQ);
+        if (Small != 0)
+        {
+            return I + __builtin_ctz(Small);
+        }
+    }
+    for (; I < Count; ++I)
+    {
+        if (std::abs(Probs[I]) < Threshold)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+template<>
+inline std::size_t FindFirstZeroProb<double>(const double* Probs,
+                                             std::size_t   Begin,
+                                             std::size_t   Count)
+{
+    const __m512d Zero = _mm512_setzero_pd();
+    std::size_t   I = Begin;
+    for (; I + 8 <= Count; I += 8)
+    {
+        const __mmask8 Zeros =
+            _mm512_cmp_pd_mask(_mm512_loadu_pd(Probs + I), Zero, _CMP_EQ_OQ);
+        if (Zeros != 0)
+        {
+            return I + __builtin_ctz(Zeros);
+        }
+    }
+    for (; I < Count; ++I)
+    {
+        if (Probs[I] == 0)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+#elif defined(__AVX2__)
+
+template<>
+inline void ScaleProbs<double>(double* Probs, std::size_t Count, double Scale)
+{
+    const __m256d Factor = _mm256_set1_pd(Scale);
+    std::size_t   I = 0;
+    for (; I + 4 <= Count; I += 4)
+    {
+        _mm256_storeu_pd(Probs + I,
+                         _mm256_mul_pd(_mm256_loadu_pd(Probs + I), Factor));
+    }
+    for (; I < Count; ++I)
+    {
+        Probs[I] *= Scale;
+    }
+}
+
+template<>
+inline double SumProbs<double>(const double* Probs, std::size_t Count)
+{
+    // Two accumulators hide the latency of the adds.
+    __m256d     Even = _mm256_setzero_pd();
+    __m256d     Odd = _mm256_setzero_pd();
+    std::size_t I = 0;
+    for (; I + 8 <= Count; I += 8)
+    {
+        Even = _mm256_add_pd(Even, _mm256_loadu_pd(Probs + I));
+        Odd = _mm256_add_pd(Odd, _mm256_loadu_pd(Probs + I + 4));
+    }
+    const __m256d Total = _mm256_add_pd(Even, Odd);
+    const __m128d Half = _mm_add_pd(_mm256_castpd256_pd128(Total),
+                                    _mm256_extractf128_pd(Total, 1));
+    double Sum = _mm_cvtsd_f64(_mm_add_sd(Half, _mm_unpackhi_pd(Half, Half)));
+    for (; I < Count; ++I)
+    {
+        Sum += Probs[I];
+    }
+    return Sum;
+}
+
+template<>
+inline std::size_t FindFirstSmallProb<double>(const double* Probs,
+                                              std::size_t   Begin,
+                                              std::size_t   Count,
+                                              double        Threshold)
+{
+    const __m256d Limit = _mm256_set1_pd(Threshold);
+    const __m256d SignBit = _mm256_set1_pd(-0.0);
+    std::size_t   I = Begin;
+    for (; I + 4 <= Count; I += 4)
+    {
+        const __m256d Magnitude =
+            _mm256_andnot_pd(SignBit, _mm256_loadu_pd(Probs + I));
+        const int Small =
+            _mm256_movemask_pd(_mm256_cmp_pd(Magnitude, Limit, _CMP_LT_OQ));
+        if (Small != 0)
+        {
+            return I + __builtin_ctz(Small);
+        }
+    }
+    for (; I < Count; ++I)
+    {
+        if (std::abs(Probs[I]) < Threshold)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+template<>
+inline std::size_t FindFirstZeroProb<double>(const double* Probs,
+                                             std::size_t   Begin,
+                                             std::size_t   Count)
+{
+    const __m256d Zero = _mm256_setzero_pd();
+    std::size_t   I = Begin;
+    for (; I + 4 <= Count; I += 4)
+    {
+        const int Zeros = _mm256_movemask_pd(
+            _mm256_cmp_pd(_mm256_loadu_pd(Probs + I), Zero, _CMP_EQ_OQ));
+        if (Zeros != 0)
+        {
+            return I + __builtin_ctz(Zeros);
+        }
+    }
+    for (; I < Count; ++I)
+    {
+        if (Probs[I] == 0)
+        {
+            return I;
+        }
+    }
+    return Count;
+}
+
+#endif
+
+template<typename ProbType>
+void NormaliseProbs(ProbType* Probs, std::size_t Count)
+{
+    const ProbType Total = SumProbs(Probs, Count);
+    if (Total != 0)
+    {
+        ScaleProbs(Probs, Count, ProbType(1) / Total);
+    }
+}
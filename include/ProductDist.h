@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// The joint distribution of independent random variables, kept as one
+// `TDist<>` per factor. k independent d-valued factors take k * d atoms
+// instead of the d^k of their joint, so independent parts of a model can be
+// set up and transformed separately and only combined where they interact:
+//
+//     auto Dice = Product(Roll(6), Roll(8), Roll(20));
+//     auto Hit = Dice.Transform<2>([](int x) { return x >= 15; })
+//                    .Apply<0, 2>([](int Damage, bool bHit)
+//                                 { return Certainly(bHit ? Damage : 0); });
+//
+// `Apply()` only enumerates the factors its continuation reads and drops the
+// rest. `Joint()` enumerates them all.
+template<typename ProbType, typename... ValueTypes> class TProductDist
+{
+public:
+    using FFactors = std::tuple<TDist<ProbType, ValueTypes>...>;
+
+    static constexpr std::size_t NumFactors = sizeof...(ValueTypes);
+
+    explicit TProductDist(TDist<ProbType, ValueTypes>... InFactors)
+        : Factors(std::move(InFactors)...)
+    {
+    }
+
+    template<std::size_t I> const auto& Factor() const
+    {
+        return std::get<I>(Factors);
+    }
+
+    // Transforms factor `I` alone, leaving the others as they are.
+    template<std::size_t I, typename F> auto Transform(const F& f) const
+    {
+        return Rebuild(
+            [&]<std::size_t J>(std::integral_constant<std::size_t, J>)
+            {
+                if constexpr (J == I)
+                {
+                    return std::get<J>(Factors).Transform(f);
+                }
+                else
+                {
+                    return std::get<J>(Factors);
+                }
+            });
+    }
+
+    // Keeps factors `Is...` and marginalises out the rest, which for
+    // independent factors just means dropping them.
+    template<std::size_t... Is> auto Project() const
+    {
+        return TProductDist<ProbType, std::tuple_element_t<Is, std::tuple<ValueTypes...>>...>(
+            std::get<Is>(Factors)...);
+    }
+
+    // Calls `f` with the values of factors `Is...` for every combination of
+    // them, like `AndThen()` on their joint. The other factors are never
+    // enumerated.
+    template<std::size_t... Is, typename F> auto Apply(const F& f) const
+    {
+        using ResultType = std::invoke_result_t<
+            F, const std::tuple_element_t<Is, std::tuple<ValueTypes...>>&...>;
+
+        ResultType result{};
+        result.Discarded = Project<Is...>().JointDiscarded();
+        ForEachCombination<0>(
+            std::forward_as_tuple(std::get<Is>(Factors)...),
+            [&](ProbType Prob, const auto&... Values)
+            {
+                auto fx = f(Values...);
+                for (auto& r : fx.PDF)
+                {
+                    result.PDF.push_back(TAtom{ std::move(r.Value), Prob * r.Prob });
+                }
+                result.Discarded += Prob * fx.Discarded;
+            });
+        result.canonicalise();
+
+        return result;
+    }
+
+    // The full joint distribution. Every factor is already canonical so the
+    // tuples come out in order and need no sorting.
+    TDist<ProbType, std::tuple<ValueTypes...>> Joint() const
+    {
+        TDist<ProbType, std::tuple<ValueTypes...>> result{};
+        result.Discarded = JointDiscarded();
+        ForEachCombination<0>(
+            Factors,
+            [&result](ProbType Prob, const ValueTypes&... Values)
+            {
+                // Products of tiny factor probabilities can underflow, and
+                // `Apply()` drops those too when it canonicalises.
+                if (Prob != 0)
+                {
+                    result.PDF.push_back(
+                        TAtom<ProbType, std::tuple<ValueTypes...>>{
+                            std::tuple<ValueTypes...>(Values...), Prob });
+                }
+            });
+
+        return result;
+    }
+
+    operator TDist<ProbType, std::tuple<ValueTypes...>>() const
+    {
+        return Joint();
+    }
+
+    // Probability lost from the joint when each factor has lost some:
+    // everything outside the product of what each kept.
+    ProbType JointDiscarded() const
+    {
+        const ProbType Kept = std::apply(
+            [](const auto&... Factor)
+            { return (ProbType(1) * ... * (1 - Factor.Discarded)); },
+            Factors);
+        return 1 - Kept;
+    }
+
+private:
+    template<std::size_t K, typename DistsType, typename SinkType,
+             typename... Vs>
+    static void ForEachCombination(const DistsType& Dists, const SinkType& Sink,
+                                   ProbType Prob = 1, const Vs&... Values)
+    {
+        if constexpr (K == std::tuple_size_v<DistsType>)
+        {
+            Sink(Prob, Values...);
+        }
+        else
+        {
+            for (const auto& [Value, FactorProb] : std::get<K>(Dists).PDF)
+            {
+                ForEachCombination<K + 1>(
+                    Dists, Sink, Prob * FactorProb, Values..., Value);
+            }
+        }
+    }
+
+    template<typename MakeFactorType>
+    auto Rebuild(const MakeFactorType& MakeFactor) const
+    {
+        return [&]<std::size_t... Js>(std::index_sequence<Js...>)
+        {
+            using ResultType = TProductDist<
+                ProbType,
+                typename TDistTypes<decltype(MakeFactor(
+                    std::integral_constant<std::size_t, Js>{}))>::Value...>;
+            return ResultType(
+                MakeFactor(std::integral_constant<std::size_t, Js>{})...);
+        }(std::index_sequence_for<ValueTypes...>{});
+    }
+
+    FFactors Factors;
+};
+
+template<typename ProbType, typename... ValueTypes>
+TProductDist<ProbType, ValueTypes...>
+Product(TDist<ProbType, ValueTypes>... Factors)
+{
+    return TProductDist<ProbType, ValueTypes...>(std::move(Factors)...);
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+// A vector that stores up to `N` elements inside the object itself and only
+// allocates, from `AllocatorType`, once it grows beyond that. Supports the
+// subset of the `std::vector<>` interface used on distributions. Iterators
+// are plain pointers. Allocators are propagated following
+// `std::allocator_traits<>`, as in the standard containers.
+template<typename T, std::size_t N, typename AllocatorType = std::allocator<T>>
+class TSmallVector
+{
+    using FTraits = std::allocator_traits<AllocatorType>;
+
+public:
+    using value_type = T;
+    using allocator_type = AllocatorType;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    TSmallVector() noexcept(noexcept(AllocatorType()))
+        : TSmallVector(AllocatorType())
+    {
+    }
+
+    explicit TSmallVector(const AllocatorType& InAllocator) noexcept
+        : Data(InlineData()), Size(0), Capacity(N), Allocator(InAllocator)
+    {
+    }
+
+    explicit TSmallVector(size_type Count) : TSmallVector() { resize(Count); }
+
+    TSmallVector(size_type Count, const T& Value) : TSmallVector()
+    {
+        resize(Count, Value);
+    }
+
+    template<std::forward_iterator IteratorType>
+    TSmallVector(IteratorType First, IteratorType Last) : TSmallVector()
+    {
+        assign(First, Last);
+    }
+
+    TSmallVector(std::initializer_list<T> Values) : TSmallVector()
+    {
+        assign(Values.begin(), Values.end());
+    }
+
+    TSmallVector(const TSmallVector& Other)
+        : TSmallVector(
+              FTraits::select_on_container_copy_construction(Other.Allocator))
+    {
+        assign(Other.begin(), Other.end());
+    }
+
+    TSmallVector(TSmallVector&& Other) noexcept
+        : TSmallVector(std::move(Other.Allocator))
+    {
+        TakeFrom(Other);
+    }
+
+    ~TSmallVector()
+    {
+        std::destroy(begin(), end());
+        Deallocate();
+    }
+
+    TSmallVector& operator=(const TSmallVector& Other)
+    {
+        if (this != &Other)
+        {
+            if constexpr (FTraits::propagate_on_container_copy_assignment::value)
+            {
+                if (Allocator != Other.Allocator)
+                {
+                    Reset();
+                }
+                Allocator = Other.Allocator;
+            }
+            assign(Other.begin(), Other.end());
+        }
+        return *this;
+    }
+
+    // Steals `Other`'s heap buffer when the allocators allow it. Otherwise
+    // moves the elements across, reusing this vector's capacity.
+    TSmallVector& operator=(TSmallVector&& Other) noexcept(
+        FTraits::propagate_on_container_move_assignment::value ||
+        FTraits::is_always_equal::value)
+    {
+        if (this == &Other)
+        {
+            return *this;
+        }
+
+        if constexpr (FTraits::propagate_on_container_move_assignment::value)
+        {
+            Reset();
+            Allocator = std::move(Other.Allocator);
+            TakeFrom(Other);
+        }
+        else
+        {
+            if (Allocator == Other.Allocator)
+            {
+                Reset();
+                TakeFrom(Other);
+            }
+            else
+            {
+                clear();
+                reserve(Other.Size);
+                std::uninitialized_move(Other.begin(), Other.end(), Data);
+                Size = Other.Size;
+                Other.clear();
+            }
+        }
+        return *this;
+    }
+
+    TSmallVector& operator=(std::initializer_list<T> Values)
+    {
+        assign(Values.begin(), Values.end());
+        return *this;
+    }
+
+    template<std::forward_iterator IteratorType>
+    void assign(IteratorType First, IteratorType Last)
+    {
+        clear();
+        reserve(static_cast<size_type>(std::distance(First, Last)));
+        std::uninitialized_copy(First, Last, Data);
+        Size = static_cast<size_type>(std::distance(First, Last));
+    }
+
+    iterator       begin() noexcept { return Data; }
+    const_iterator begin() const noexcept { return Data; }
+    iterator       end() noexcept { return Data + Size; }
+    const_iterator end() const noexcept { return Data + Size; }
+
+    T*       data() noexcept { return Data; }
+    const T* data() const noexcept { return Data; }
+
+    size_type size() const noexcept { return Size; }
+    size_type capacity() const noexcept { return Capacity; }
+    bool      empty() const noexcept { return Size == 0; }
+
+    AllocatorType get_allocator() const { return Allocator; }
+
+    // True while the elements are stored inside the object.
+    bool IsInline() const noexcept { return Data == InlineData(); }
+
+    T&       operator[](size_type Index) { return Data[Index]; }
+    const T& operator[](size_type Index) const { return Data[Index]; }
+
+    T&       front() { return Data[0]; }
+    const T& front() const { return Data[0]; }
+    T&       back() { return Data[Size - 1]; }
+    const T& back() const { return Data[Size - 1]; }
+
+    void reserve(size_type NewCapacity)
+    {
+        if (NewCapacity > Capacity)
+        {
+            Reallocate(NewCapacity);
+        }
+    }
+
+    void push_back(const T& Value) { emplace_back(Value); }
+
+    void push_back(T&& Value) { emplace_back(std::move(Value)); }
+
+    template<typename... ArgTypes> T& emplace_back(ArgTypes&&... Args)
+    {
+        if (Size == Capacity)
+        {
+            // Construct first in case the arguments refer to an element.
+            T Value(std::forward<ArgTypes>(Args)...);
+            Reallocate(GrownCapacity(Size + 1));
+            std::construct_at(Data + Size, std::move(Value));
+        }
+        else
+        {
+            std::construct_at(Data + Size, std::forward<ArgTypes>(Args)...);
+        }
+        return Data[Size++];
+    }
+
+    void pop_back() { std::destroy_at(Data + --Size); }
+
+    void clear() noexcept
+    {
+        std::destroy(begin(), end());
+        Size = 0;
+    }
+
+    void resize(size_type Count)
+    {
+        if (Count < Size)
+        {
+            std::destroy(Data + Count, end());
+        }
+        else
+        {
+            reserve(Count);
+            std::uninitialized_value_construct(end(), Data + Count);
+        }
+        Size = Count;
+    }
+
+    void resize(size_type Count, const T& Value)
+    {
+        if (Count < Size)
+        {
+            std::destroy(Data + Count, end());
+        }
+        else if (Count > Size)
+        {
+            const T Copy = Value;
+            reserve(Count);
+            std::uninitialized_fill(end(), Data + Count, Copy);
+        }
+        Size = Count;
+    }
+
+    iterator erase(const_iterator Position) { return erase(Position, Position + 1); }
+
+    iterator erase(const_iterator First, const_iterator Last)
+    {
+        T* const Target = Data + (First - Data);
+        T* const Source = Data + (Last - Data);
+        if (Source != Target)
+        {
+            T* const NewEnd = std::move(Source, end(), Target);
+            std::destroy(NewEnd, end());
+            Size = static_cast<size_type>(NewEnd - Data);
+        }
+        return Target;
+    }
+
+    // The inserted elements are appended and then rotated into place.
+    template<std::forward_iterator IteratorType>
+    iterator insert(const_iterator Position, IteratorType First,
+                    IteratorType Last)
+    {
+        const size_type Index = static_cast<size_type>(Position - Data);
+        const size_type Count = static_cast<size_type>(std::distance(First, Last));
+        if (Size + Count > Capacity)
+        {
+            Reallocate(GrownCapacity(Size + Count));
+        }
+        std::uninitialized_copy(First, Last, end());
+        Size += Count;
+        std::rotate(Data + Index, end() - Count, end());
+        return Data + Index;
+    }
+
+    iterator insert(const_iterator Position, size_type Count, const T& Value)
+    {
+        const size_type Index = static_cast<size_type>(Position - Data);
+        const T         Copy = Value;
+        if (Size + Count > Capacity)
+        {
+            Reallocate(GrownCapacity(Size + Count));
+        }
+        std::uninitialized_fill(end(), end() + Count, Copy);
+        Size += Count;
+        std::rotate(Data + Index, end() - Count, end());
+        return Data + Index;
+    }
+
+    iterator insert(const_iterator Position, const T& Value)
+    {
+        return insert(Position, 1, Value);
+    }
+
+    friend bool operator==(const TSmallVector& A, const TSmallVector& B)
+    {
+        return std::equal(A.begin(), A.end(), B.begin(), B.end());
+    }
+
+private:
+    T* InlineData() noexcept { return reinterpret_cast<T*>(Inline); }
+
+    const T* InlineData() const noexcept
+    {
+        return reinterpret_cast<const T*>(Inline);
+    }
+
+    size_type GrownCapacity(size_type MinCapacity) const
+    {
+        return std::max(MinCapacity, 2 * Capacity);
+    }
+
+    void Reallocate(size_type NewCapacity)
+    {
+        T* const NewData = FTraits::allocate(Allocator, NewCapacity);
+        std::uninitialized_move(begin(), end(), NewData);
+        std::destroy(begin(), end());
+        Deallocate();
+        Data = NewData;
+        Capacity = NewCapacity;
+    }
+
+    void Deallocate() noexcept
+    {
+        if (!IsInline())
+        {
+            FTraits::deallocate(Allocator, Data, Capacity);
+        }
+    }
+
+    // Destroys the elements and returns to the empty inline state.
+    void Reset() noexcept
+    {
+        clear();
+        Deallocate();
+        Data = InlineData();
+        Capacity = N;
+    }
+
+    // Takes `Other`'s elements, leaving it empty. Expects this to be empty
+    // and inline, with an allocator that can free `Other`'s buffer.
+    void TakeFrom(TSmallVector& Other) noexcept
+    {
+        if (Other.IsInline())
+        {
+            std::uninitialized_move(Other.begin(), Other.end(), Data);
+            Size = Other.Size;
+            Other.clear();
+        }
+        else
+        {
+            Data = Other.Data;
+            Size = Other.Size;
+            Capacity = Other.Capacity;
+            Other.Data = Other.InlineData();
+            Other.Size = 0;
+            Other.Capacity = N;
+        }
+    }
+
+    T*        Data;
+    size_type Size;
+    size_type Capacity;
+    [[no_unique_address]] AllocatorType Allocator;
+    alignas(T) std::byte Inline[N == 0 ? 1 : N * sizeof(T)];
+};
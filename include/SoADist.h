@@ -0,0 +1,279 @@
+#pragma once
+
+// A distribution stored as two parallel arrays, one of values and one of
+// probabilities, instead of the array of `TAtom<>`s in `TDist<>`. Passes that
+// only touch probabilities, such as scaling in `AndThen()`, `remove_zero()`,
+// `chop()` and `check()`, run over a contiguous array using the kernels in
+// ProbKernels.h. Iterating yields `(Value, Prob)` pairs so
+//
+//     for (auto [Value, Prob] : Dist)
+//
+// works as it does for `TDist<>`. Converts implicitly to and from `TDist<>`.
+template<typename ProbType, typename ValueType> struct TSoADist
+{
+    struct FAtomRef
+    {
+        const ValueType& Value;
+        const ProbType&  Prob;
+    };
+
+    // Walks the two arrays in step.
+    struct FIterator
+    {
+        using difference_type = std::ptrdiff_t;
+        using value_type = FAtomRef;
+
+        FAtomRef operator*() const { return FAtomRef{ *Value, *Prob }; }
+
+        FIterator& operator++()
+        {
+            ++Value;
+            ++Prob;
+            return *this;
+        }
+
+        FIterator operator++(int)
+        {
+            FIterator Previous = *this;
+            ++*this;
+            return Previous;
+        }
+
+        bool operator==(const FIterator& Other) const
+        {
+            return Value == Other.Value;
+        }
+
+        const ValueType* Value;
+        const ProbType*  Prob;
+    };
+
+    TSoADist() = default;
+
+    TSoADist(std::vector<ValueType> InValues, std::vector<ProbType> InProbs)
+        : Values(std::move(InValues)), Probs(std::move(InProbs))
+    {
+        canonicalise();
+    }
+
+    TSoADist(const TDist<ProbType, ValueType>& Dist)
+    {
+        Values.reserve(Dist.PDF.size());
+        Probs.reserve(Dist.PDF.size());
+        for (const auto& [Value, Prob] : Dist.PDF)
+        {
+            Values.push_back(Value);
+            Probs.push_back(Prob);
+        }
+    }
+
+    operator TDist<ProbType, ValueType>() const
+    {
+        TDist<ProbType, ValueType> result{};
+        result.PDF.reserve(size());
+        for (std::size_t I = 0; I < size(); ++I)
+        {
+            result.PDF.push_back(
+                TAtom<ProbType, ValueType>{ Values[I], Probs[I] });
+        }
+
+        return result;
+    }
+
+    TDist<ProbType, ValueType> ToDist() const { return *this; }
+
+    std::size_t size() const { return Values.size(); }
+
+    FIterator begin() const { return FIterator{ Values.data(), Probs.data() }; }
+
+    FIterator end() const
+    {
+        return FIterator{ Values.data() + size(), Probs.data() + size() };
+    }
+
+    ProbType Total() const { return SumProbs(Probs.data(), Probs.size()); }
+
+    void Scale(ProbType Factor) { ScaleProbs(Probs.data(), Probs.size(), Factor); }
+
+    void Normalise() { NormaliseProbs(Probs.data(), Probs.size()); }
+
+    void remove_zero()
+    {
+        Compact([this](std::size_t Begin)
+                { return FindFirstZeroProb(Probs.data(), Begin, Probs.size()); });
+    }
+
+    void chop(ProbType eps)
+    {
+        Compact(
+            [this, eps](std::size_t Begin)
+            {
+                return FindFirstSmallProb(Probs.data(), Begin, Probs.size(), eps);
+            });
+    }
+
+    void canonicalise()
+    {
+        if (!std::is_sorted(Values.begin(), Values.end()))
+        {
+            // Sort a permutation rather than the arrays themselves, then
+            // gather both arrays through it.
+            std::vector<std::size_t> Order(size());
+            std::iota(Order.begin(), Order.end(), std::size_t(0));
+            std::sort(Order.begin(),
+                      Order.end(),
+                      [this](std::size_t A, std::size_t B)
+                      { return Values[A] < Values[B]; });
+
+            std::vector<ValueType> SortedValues;
+            std::vector<ProbType>  SortedProbs;
+            SortedValues.reserve(size());
+            SortedProbs.reserve(size());
+            for (std::size_t Index : Order)
+            {
+                SortedValues.push_back(std::move(Values[Index]));
+                SortedProbs.push_back(Probs[Index]);
+            }
+            Values = std::move(SortedValues);
+            Probs = std::move(SortedProbs);
+        }
+
+        Merge();
+        remove_zero();
+    }
+
+    // Assumes values are sorted. Merges runs of equal values.
+    void Merge()
+    {
+        std::size_t               Out = 0;
+        TCompensatedSum<ProbType> Run;
+        for (std::size_t In = 0; In < size(); ++In)
+        {
+            if (Out > 0 && Values[Out - 1] == Values[In])
+            {
+                Run.Add(Probs[In]);
+            }
+            else
+            {
+                if (Out > 0)
+                {
+                    Probs[Out - 1] = Run.Result();
+                }
+                Run = TCompensatedSum<ProbType>{ Probs[In] };
+                if (Out != In)
+                {
+                    Values[Out] = std::move(Values[In]);
+                    Probs[Out] = Probs[In];
+                }
+                ++Out;
+            }
+        }
+        if (Out > 0)
+        {
+            Probs[Out - 1] = Run.Result();
+        }
+        Values.resize(Out);
+        Probs.resize(Out);
+    }
+
+    // `f` may return a `TSoADist<>` or a `TDist<>`. The result is always a
+    // `TSoADist<>`.
+    template<typename F> auto AndThen(const F& f) const
+    {
+        using FResultType = std::invoke_result_t<F, ValueType>;
+        using ResultProbType = typename TDistTypes<FResultType>::Prob;
+        using ResultValueType = typename TDistTypes<FResultType>::Value;
+
+        TSoADist<ResultProbType, ResultValueType> result;
+        for (std::size_t I = 0; I < size(); ++I)
+        {
+            auto fx = f(Values[I]);
+            if constexpr (std::same_as<FResultType,
+                                       TSoADist<ResultProbType, ResultValueType>>)
+            {
+                const std::size_t Start = result.size();
+                result.Values.insert(
+                    result.Values.end(), fx.Values.begin(), fx.Values.end());
+                result.Probs.insert(
+                    result.Probs.end(), fx.Probs.begin(), fx.Probs.end());
+                ScaleProbs(result.Probs.data() + Start, fx.size(), Probs[I]);
+            }
+            else
+            {
+                for (const auto& [Value, Prob] : fx)
+                {
+                    result.Values.push_back(Value);
+                    result.Probs.push_back(Probs[I] * Prob);
+                }
+            }
+        }
+
+        result.canonicalise();
+
+        return result;
+    }
+
+    template<typename F>
+    TSoADist<ProbType, std::invoke_result_t<F, ValueType>>
+    Transform(const F& f) const
+    {
+        TSoADist<ProbType, std::invoke_result_t<F, ValueType>> result;
+        result.Values.reserve(size());
+        for (const ValueType& Value : Values)
+        {
+            result.Values.push_back(f(Value));
+        }
+        result.Probs = Probs;
+
+        result.canonicalise();
+
+        return result;
+    }
+
+    void check() const { std::cout << "total = " << Total() << std::endl; }
+
+    void dump() const
+    {
+        for (const auto& [Value, Prob] : *this)
+        {
+            std::cout << Value << ": " << Prob << std::endl;
+        }
+    }
+
+    std::vector<ValueType> Values;
+    std::vector<ProbType>  Probs;
+
+private:
+    // Removes the atoms found by `FindNext(Begin)`, which returns the index
+    // of the next atom to remove at or after `Begin`, or `size()`. Runs of
+    // kept atoms are moved down in blocks.
+    template<typename FindType> void Compact(const FindType& FindNext)
+    {
+        const std::size_t Count = size();
+        std::size_t       Out = FindNext(0);
+        if (Out == Count)
+        {
+            return;
+        }
+
+        for (std::size_t In = Out + 1; In < Count;)
+        {
+            const std::size_t Next = FindNext(In);
+            std::move(Values.begin() + In,
+                      Values.begin() + Next,
+                      Values.begin() + Out);
+            std::copy(Probs.begin() + In, Probs.begin() + Next, Probs.begin() + Out);
+            Out += Next - In;
+            In = Next + 1;
+        }
+        Values.resize(Out);
+        Probs.resize(Out);
+    }
+};
+
+template<typename ProbType, typename ValueType>
+struct TDistTypes<TSoADist<ProbType, ValueType>>
+{
+    using Prob = ProbType;
+    using Value = ValueType;
+};
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Numbers the states of a struct whose fields each take a small bounded range
+// of values. Field `k` is a digit in `[0, Radix[k])` and a state is the index
+// `sum(Digit[k] * Stride[k])`, with the last field varying fastest. Digits
+// outside their range would alias another state or index past the end, so
+// they throw `std::out_of_range` in every build.
+template<std::size_t... Radices> struct TMixedRadix
+{
+    static constexpr std::size_t NumFields = sizeof...(Radices);
+
+    using FDigits = std::array<int, NumFields>;
+
+    static constexpr std::array<std::size_t, NumFields> Radix{ Radices... };
+
+    static constexpr std::array<std::size_t, NumFields> Stride = []
+    {
+        std::array<std::size_t, NumFields> Strides{};
+        std::size_t                        Product = 1;
+        for (std::size_t K = NumFields; K-- > 0;)
+        {
+            Strides[K] = Product;
+            Product *= Radix[K];
+        }
+        return Strides;
+    }();
+
+    static constexpr std::size_t Size = (std::size_t(1) * ... * Radices);
+
+    static void CheckField(std::size_t Field)
+    {
+        if (Field >= NumFields)
+        {
+            throw std::out_of_range("TMixedRadix: field " +
+                                    std::to_string(Field) + " of " +
+                                    std::to_string(NumFields));
+        }
+    }
+
+    static void CheckDigit(std::size_t Field, int Digit)
+    {
+        if (Digit < 0 || static_cast<std::size_t>(Digit) >= Radix[Field])
+        {
+            throw std::out_of_range("TMixedRadix: digit " +
+                                    std::to_string(Digit) + " of field " +
+                                    std::to_string(Field) + " is outside [0, " +
+                                    std::to_string(Radix[Field]) + ")");
+        }
+    }
+
+    static std::size_t Encode(const FDigits& Digits)
+    {
+        std::size_t Index = 0;
+        for (std::size_t K = 0; K < NumFields; ++K)
+        {
+            CheckDigit(K, Digits[K]);
+            Index += Digits[K] * Stride[K];
+        }
+        return Index;
+    }
+
+    static FDigits Decode(std::size_t Index)
+    {
+        FDigits Digits;
+        for (std::size_t K = 0; K < NumFields; ++K)
+        {
+            Digits[K] = static_cast<int>(Index / Stride[K] % Radix[K]);
+        }
+        return Digits;
+    }
+};
+
+// Specialise for a state type to store its distributions in a
+// `TTensorDist<>`. The specialisation derives from `TMixedRadix<>` with one
+// radix per field and converts between the state and its digits:
+//
+//     template<> struct TStateCodec<FState> : TMixedRadix<17, 13, 3>
+//     {
+//         static FDigits ToDigits(const FState& State);
+//         static FState  FromDigits(const FDigits& Digits);
+//     };
+template<typename ValueType> struct TStateCodec;
+
+template<typename ValueType>
+concept CTensorState = requires(const ValueType& Value) {
+    { TStateCodec<ValueType>::Size } -> std::convertible_to<std::size_t>;
+    {
+        TStateCodec<ValueType>::FromDigits(
+            TStateCodec<ValueType>::ToDigits(Value))
+    } -> std::convertible_to<ValueType>;
+};
+
+// A distribution over every state `TStateCodec<ValueType>` can number, stored
+// as one probability per state. Continuations scatter their results straight
+// to the index of each state instead of sorting and merging atoms, and
+// `UpdateField()` and `Marginal()` work on the digits without building
+// states at all. The whole state space is allocated, so this suits spaces of
+// up to a few million states. Converts to and from `TDist<>`.
+template<typename ProbType, typename ValueType> struct TTensorDist
+{
+    static_assert(CTensorState<ValueType>);
+
+    using CodecType = TStateCodec<ValueType>;
+
+    TTensorDist() : Probs(CodecType::Size, ProbType(0)) {}
+
+    TTensorDist(const TDist<ProbType, ValueType>& Dist) : TTensorDist()
+    {
+        Add(Dist, ProbType(1));
+    }
+
+    operator TDist<ProbType, ValueType>() const
+    {
+        TDist<ProbType, ValueType> result{};
+        for (std::size_t I = 0; I < Probs.size(); ++I)
+        {
+            if (Probs[I] != 0)
+            {
+                result.PDF.push_back(
+                    TAtom<ProbType, ValueType>{ ValueAt(I), Probs[I] });
+            }
+        }
+        // Indices run in digit order, which need not be the order of the
+        // values.
+        result.canonicalise();
+        result.Discarded = Discarded;
+
+        return result;
+    }
+
+    TDist<ProbType, ValueType> ToDist() const { return *this; }
+
+    static std::size_t IndexOf(const ValueType& Value)
+    {
+        return CodecType::Encode(CodecType::ToDigits(Value));
+    }
+
+    static ValueType ValueAt(std::size_t Index)
+    {
+        return CodecType::FromDigits(CodecType::Decode(Index));
+    }
+
+    // Adds `Scale` times `Other` to this distribution.
+    void Add(const TDist<ProbType, ValueType>& Other, ProbType Scale)
+    {
+        for (const auto& [Value, Prob] : Other.PDF)
+        {
+            Probs[IndexOf(Value)] += Scale * Prob;
+        }
+        Discarded += Scale * Other.Discarded;
+    }
+
+    template<typename F> auto AndThen(const F& f) const
+    {
+        using ResultType = std::invoke_result_t<F, ValueType>;
+        using ResultProbType = typename TDistTypes<ResultType>::Prob;
+        using ResultValueType = typename TDistTypes<ResultType>::Value;
+
+        if constexpr (CTensorState<ResultValueType>)
+        {
+            TTensorDist<ResultProbType, ResultValueType> result;
+            result.Discarded = Discarded;
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    result.Add(f(ValueAt(I)), Probs[I]);
+                }
+            }
+
+            return result;
+        }
+        else
+        {
+            return ToDist().AndThen(f);
+        }
+    }
+
+    template<typename F> auto Transform(const F& f) const
+    {
+        using ResultValueType = std::invoke_result_t<F, ValueType>;
+
+        if constexpr (CTensorState<ResultValueType>)
+        {
+            TTensorDist<ProbType, ResultValueType> result;
+            result.Discarded = Discarded;
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    result.Probs[TTensorDist<ProbType, ResultValueType>::IndexOf(
+                        f(ValueAt(I)))] += Probs[I];
+                }
+            }
+
+            return result;
+        }
+        else
+        {
+            return ToDist().Transform(f);
+        }
+    }
+
+    // Moves the probability of every state to its `CanonicalState()`.
+    void ReduceSymmetry()
+    {
+        if constexpr (CSymmetric<ValueType>)
+        {
+            for (std::size_t I = 0; I < Probs.size(); ++I)
+            {
+                if (Probs[I] != 0)
+                {
+                    const std::size_t J = IndexOf(CanonicalState(ValueAt(I)));
+                    if (J != I)
+                    {
+                        Probs[J] += Probs[I];
+                        Probs[I] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    // Replaces digit `Field` of every state with a draw from `f(Digit)`,
+    // the dense version of `UpdateFieldP()`. `f` is called once per possible
+    // digit and the other fields are never decoded.
+    template<typename F> TTensorDist UpdateField(std::size_t Field, const F& f) const
+    {
+        CodecType::CheckField(Field);
+        const std::size_t Radix = CodecType::Radix[Field];
+        const std::size_t Stride = CodecType::Stride[Field];
+
+        std::vector<TDist<ProbType, int>> Updates;
+        Updates.reserve(Radix);
+        for (std::size_t Digit = 0; Digit < Radix; ++Digit)
+        {
+            Updates.push_back(f(static_cast<int>(Digit)));
+            for (const auto& [NewDigit, Prob] : Updates.back().PDF)
+            {
+                CodecType::CheckDigit(Field, NewDigit);
+            }
+        }
+
+        TTensorDist result;
+        result.Discarded = Discarded;
+        for (std::size_t Outer = 0; Outer < Probs.size(); Outer += Radix * Stride)
+        {
+            for (std::size_t Digit = 0; Digit < Radix; ++Digit)
+            {
+                const ProbType* Source = &Probs[Outer + Digit * Stride];
+                for (const auto& [NewDigit, Prob] : Updates[Digit].PDF)
+                {
+                    ProbType* Target = &result.Probs[Outer + NewDigit * Stride];
+                    for (std::size_t Inner = 0; Inner < Stride; ++Inner)
+                    {
+                        Target[Inner] += Prob * Source[Inner];
+                    }
+                }
+            }
+        }
+        if (std::any_of(Updates.begin(),
+                        Updates.end(),
+                        [](const auto& Update) { return Update.Discarded != 0; }))
+        {
+            const auto Weights = Marginal(Field);
+            for (std::size_t Digit = 0; Digit < Radix; ++Digit)
+            {
+                result.Discarded += Updates[Digit].Discarded * Weights.Probs[Digit];
+            }
+        }
+
+        return result;
+    }
+
+    // The distribution of digit `Field` alone, summing over the others.
+    TDenseDist<ProbType, int> Marginal(std::size_t Field) const
+    {
+        CodecType::CheckField(Field);
+        const std::size_t Radix = CodecType::Radix[Field];
+        const std::size_t Stride = CodecType::Stride[Field];
+
+        std::vector<ProbType> Sums(Radix, ProbType(0));
+        for (std::size_t Outer = 0; Outer < Probs.size(); Outer += Radix * Stride)
+        {
+            for (std::size_t Digit = 0; Digit < Radix; ++Digit)
+            {
+                const ProbType* Source = &Probs[Outer + Digit * Stride];
+                for (std::size_t Inner = 0; Inner < Stride; ++Inner)
+                {
+                    Sums[Digit] += Source[Inner];
+                }
+            }
+        }
+
+        return TDenseDist<ProbType, int>(0, std::move(Sums));
+    }
+
+    void check() const
+    {
+        double total = 0.0;
+
+        for (const auto& Prob : Probs)
+        {
+            total += Prob;
+        }
+
+        std::cout << "total = " << total << std::endl;
+        if (Discarded != 0)
+        {
+            std::cout << "discarded = " << Discarded << std::endl;
+        }
+    }
+
+    std::vector<ProbType> Probs;
+    ProbType              Discarded = 0;
+};
+
+template<typename ProbType, typename ValueType>
+struct TDistTypes<TTensorDist<ProbType, ValueType>>
+{
+    using Prob = ProbType;
+    using Value = ValueType;
+};
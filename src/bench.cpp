@@ -0,0 +1,974 @@
+// Timings for alternative implementations of the same operation. Each
+// benchmark prints the time taken and a summary of the result so the
+// alternatives can be checked against each other.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+
+#include "ChanceScript.h"
+
+// Counts calls to the global allocator so benchmarks can report allocations.
+static std::size_t NumAllocations = 0;
+
+void* operator new(std::size_t Size)
+{
+    ++NumAllocations;
+    if (void* Memory = std::malloc(Size == 0 ? 1 : Size))
+    {
+        return Memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t Size, std::align_val_t Alignment)
+{
+    ++NumAllocations;
+    const auto Align = static_cast<std::size_t>(Alignment);
+    if (void* Memory = std::aligned_alloc(Align, (Size + Align - 1) / Align * Align))
+    {
+        return Memory;
+    }
+    throw std::bad_alloc();
+}
+
+// Kept out of line: once inlined, GCC pairs the `free()` with what it takes
+// to be the standard `operator new` and warns about mismatched deallocation,
+// although both sides here are the malloc family.
+[[gnu::noinline]] void operator delete(void* Memory) noexcept { std::free(Memory); }
+
+[[gnu::noinline]] void operator delete(void* Memory, std::size_t) noexcept
+{
+    std::free(Memory);
+}
+
+[[gnu::noinline]] void operator delete(void* Memory, std::align_val_t) noexcept
+{
+    std::free(Memory);
+}
+
+[[gnu::noinline]] void operator delete(void* Memory, std::size_t,
+                                       std::align_val_t) noexcept
+{
+    std::free(Memory);
+}
+
+template<typename F> void Time(const std::string& Name, const F& Run)
+{
+    const auto Start = std::chrono::steady_clock::now();
+    const auto Summary = Run();
+    const auto Stop = std::chrono::steady_clock::now();
+
+    std::cout << "  " << Name << ": "
+              << std::chrono::duration<double, std::milli>(Stop - Start).count()
+              << " ms (" << Summary << ")" << std::endl;
+}
+
+auto RandomWalk(int N, EMergeStrategy Strategy)
+{
+    struct FState
+    {
+        int X;
+        int Y;
+
+        auto operator<=>(const FState& Other) const = default;
+
+        std::size_t GetTypeHash() const { return HashCombine(X, Y); }
+    };
+
+    auto Dist = Certainly(FState{ 0, 0 });
+
+    for (int T = 0; T < N; ++T)
+    {
+        Dist = Dist.AndThen(
+            [](const auto& State)
+            {
+                return Roll(4).Transform(
+                    [&State](int Direction)
+                    {
+                        switch (Direction)
+                        {
+                            case 1:
+                                return FState{ State.X - 1, State.Y };
+                            case 2:
+                                return FState{ State.X + 1, State.Y };
+                            case 3:
+                                return FState{ State.X, State.Y - 1 };
+                            default:
+                                return FState{ State.X, State.Y + 1 };
+                        }
+                    });
+            },
+            Strategy);
+    }
+
+    return Dist.PDF.size();
+}
+
+auto TimeToHitZero(int N, EMergeStrategy Strategy)
+{
+    struct FState
+    {
+        int N;
+        int Count;
+
+        auto operator<=>(const FState& Other) const = default;
+
+        std::size_t GetTypeHash() const { return HashCombine(N, Count); }
+    };
+
+    auto Dist = Certainly(FState{ N, 0 });
+
+    for (int T = 0; T < N; ++T)
+    {
+        Dist = Dist.AndThen(
+            [](const auto& State)
+            {
+                if (State.N <= 0)
+                {
+                    return Certainly(State);
+                }
+                else
+                {
+                    return Roll(6).Transform(
+                        [&State](int Value)
+                        {
+                            return FState{ std::max(0, State.N - Value),
+                                           State.Count + 1 };
+                        });
+                }
+            },
+            Strategy);
+    }
+
+    return Dist.PDF.size();
+}
+
+void BenchMergeStrategies()
+{
+    const std::pair<const char*, EMergeStrategy> Strategies[] = {
+        { "Sort", EMergeStrategy::Sort },
+        { "Hash", EMergeStrategy::Hash },
+        { "KWayMerge", EMergeStrategy::KWayMerge },
+    };
+
+    std::cout << "RandomWalk(100)" << std::endl;
+    for (auto [Name, Strategy] : Strategies)
+    {
+        Time(Name, [Strategy] { return RandomWalk(100, Strategy); });
+    }
+
+    std::cout << "TimeToHitZero(1000)" << std::endl;
+    for (auto [Name, Strategy] : Strategies)
+    {
+        Time(Name, [Strategy] { return TimeToHitZero(1000, Strategy); });
+    }
+}
+
+void BenchConvolution()
+{
+    std::cout << "Convolve n x n" << std::endl;
+    for (std::size_t Size : { 16, 32, 64, 128, 256, 512, 1024, 4096 })
+    {
+        const std::vector<double> Probs(Size, 1. / Size);
+        const int                 Repeats = static_cast<int>(65536 / Size);
+
+        std::cout << " n = " << Size << std::endl;
+        Time("Direct",
+             [&]
+             {
+                 double Total = 0;
+                 for (int R = 0; R < Repeats; ++R)
+                 {
+                     Total += ConvolveDirect(Probs, Probs)[Size - 1];
+                 }
+                 return Total;
+             });
+        Time("FFT",
+             [&]
+             {
+                 double Total = 0;
+                 for (int R = 0; R < Repeats; ++R)
+                 {
+                     Total += ConvolveFFT(Probs, Probs)[Size - 1];
+                 }
+                 return Total;
+             });
+    }
+
+    std::cout << "Roll(200, 20)" << std::endl;
+    Time("SumOf", [] { return Roll(200, 20).PDF.size(); });
+    Time("Repeated +",
+         []
+         {
+             auto Dist = Certainly(0);
+             for (int I = 0; I < 200; ++I)
+             {
+                 Dist = Dist + Roll(20);
+             }
+             return Dist.PDF.size();
+         });
+    Time("AndThen",
+         []
+         {
+             auto Dist = Certainly(0);
+             for (int I = 0; I < 200; ++I)
+             {
+                 Dist = Dist.AndThen(
+                     [](int Total)
+                     {
+                         return Roll(20).Transform([Total](int Value)
+                                                   { return Total + Value; });
+                     });
+             }
+             return Dist.PDF.size();
+         });
+}
+
+void BenchParallel()
+{
+    // A wide state expansion, as in the ex2 style combat simulations.
+    const auto Start = Roll(20000).Transform([](int x) { return x * 7919 % 20011; });
+    auto Step = [](int x)
+    {
+        return Roll(20).Transform([x](int y) { return (x * y) % 100003; });
+    };
+
+    std::cout << "AndThen over 20000 atoms" << std::endl;
+    Time("Sequential", [&] { return Start.AndThen(Step).PDF.size(); });
+    for (unsigned NumThreads : { 1u, 2u, 4u, 8u, 0u })
+    {
+        Time("Parallel(" + std::to_string(NumThreads) + ")",
+             [&]
+             { return Start.AndThen(FParallel{ NumThreads }, Step).PDF.size(); });
+    }
+}
+
+void BenchSoA()
+{
+    auto Dist = Roll(1 << 20).Transform([](int x) { return x * 2; });
+    for (std::size_t I = 0; I < Dist.PDF.size(); I += 3)
+    {
+        Dist.PDF[I].Prob = 1e-12;
+    }
+    const TSoADist<double, int> SoA = Dist;
+
+    std::cout << "Probability passes over 2^20 atoms" << std::endl;
+    Time("Sum TDist",
+         [&]
+         {
+             double Total = 0;
+             for (const auto& [Value, Prob] : Dist)
+             {
+                 Total += Prob;
+             }
+             return Total;
+         });
+    Time("Sum TSoADist", [&] { return SoA.Total(); });
+    Time("chop TDist",
+         [&]
+         {
+             auto Copy = Dist;
+             Copy.chop(1e-9);
+             return Copy.PDF.size();
+         });
+    Time("chop TSoADist",
+         [&]
+         {
+             auto Copy = SoA;
+             Copy.chop(1e-9);
+             return Copy.size();
+         });
+}
+
+// Two copies of the `TimeToHitZero` state, one of which always stores its
+// atoms on the heap.
+struct FInlineState
+{
+    int N;
+    int Count;
+
+    auto operator<=>(const FInlineState& Other) const = default;
+};
+
+struct FHeapState
+{
+    int N;
+    int Count;
+
+    auto operator<=>(const FHeapState& Other) const = default;
+};
+
+template<> struct TInlineAtoms<double, FHeapState>
+{
+    static constexpr std::size_t Value = 0;
+};
+
+template<typename StateType> double AllocationsPerAndThen(int N)
+{
+    auto Dist = Certainly(StateType{ N, 0 });
+
+    const std::size_t Before = NumAllocations;
+    for (int T = 0; T < N; ++T)
+    {
+        Dist = Dist.AndThen(
+            [](const StateType& State)
+            {
+                if (State.N <= 0)
+                {
+                    return Certainly(State);
+                }
+                return Roll(6).Transform(
+                    [&State](int Value)
+                    {
+                        return StateType{ std::max(0, State.N - Value),
+                                          State.Count + 1 };
+                    });
+            });
+    }
+
+    return static_cast<double>(NumAllocations - Before) / N;
+}
+
+void BenchInlineAtoms()
+{
+    std::cout << "Allocations per AndThen, TimeToHitZero(200)" << std::endl;
+    Time("Inline", [] { return AllocationsPerAndThen<FInlineState>(200); });
+    Time("Heap", [] { return AllocationsPerAndThen<FHeapState>(200); });
+}
+
+void BenchArena()
+{
+    auto Step = [](int x)
+    {
+        return Roll(6).AndThen(
+            [x](int y)
+            { return Roll(4).Transform([x, y](int z) { return (x + y * z) % 1009; }); });
+    };
+
+    std::cout << "Allocations per AndThen, 50 steps over 1009 states"
+              << std::endl;
+    auto Run = [&](bool bArena)
+    {
+        auto Dist = Certainly(0);
+        std::optional<FArenaScope> Arena;
+        if (bArena)
+        {
+            Arena.emplace();
+        }
+        const std::size_t Before = NumAllocations;
+        for (int T = 0; T < 50; ++T)
+        {
+            if (Arena)
+            {
+                Arena->Release();
+            }
+            Dist = Dist.AndThen(OnHeap(Step));
+        }
+        return static_cast<double>(NumAllocations - Before) / 50;
+    };
+    Time("Heap", [&] { return Run(false); });
+    Time("FArenaScope", [&] { return Run(true); });
+}
+
+void BenchMoveAndThen()
+{
+    auto Step = [](int x)
+    { return Roll(6).Transform([x](int y) { return (x * 31 + y) % 4099; }); };
+
+    std::cout << "Allocations per AndThen, 100 steps over 4099 states"
+              << std::endl;
+    Time("Copy",
+         [&]
+         {
+             auto              Dist = Roll(4099);
+             const std::size_t Before = NumAllocations;
+             for (int T = 0; T < 100; ++T)
+             {
+                 Dist = Dist.AndThen(Step);
+             }
+             return static_cast<double>(NumAllocations - Before) / 100;
+         });
+    Time("Move",
+         [&]
+         {
+             auto              Dist = Roll(4099);
+             const std::size_t Before = NumAllocations;
+             for (int T = 0; T < 100; ++T)
+             {
+                 Dist = std::move(Dist).AndThen(Step);
+             }
+             return static_cast<double>(NumAllocations - Before) / 100;
+         });
+}
+
+void BenchLazy()
+{
+    const auto Start = Roll(1 << 16);
+    auto       Scramble = [](int x) { return x * 7919 % 65537; };
+    auto       Step = [](int x)
+    { return Roll(6).Transform([x](int y) { return x * 6 + y; }); };
+
+    std::cout << "Transform, AndThen, Transform over 2^16 atoms" << std::endl;
+    Time("Eager",
+         [&]
+         {
+             return Start.Transform(Scramble)
+                 .AndThen(Step)
+                 .Transform(Scramble)
+                 .PDF.size();
+         });
+    Time("Lazy",
+         [&]
+         {
+             return Start.Lazy()
+                 .Transform(Scramble)
+                 .AndThen(Step)
+                 .Transform(Scramble)
+                 .Collect()
+                 .PDF.size();
+         });
+}
+
+void BenchOrderedTransform()
+{
+    const auto Dist = Roll(1 << 20).Transform([](int x) { return x * 0.5; });
+    auto       Shift = [](double x) { return x + 1; };
+
+    std::cout << "x + 1 over 2^20 atoms" << std::endl;
+    Time("Transform", [&] { return Dist.Transform(Shift).PDF.size(); });
+    Time("TransformMonotone",
+         [&] { return Dist.TransformMonotone(Shift).PDF.size(); });
+    Time("TransformStrictlyMonotone",
+         [&] { return Dist.TransformStrictlyMonotone(Shift).PDF.size(); });
+}
+
+struct FWalkState
+{
+    int X;
+    int Y;
+
+    auto operator<=>(const FWalkState& Other) const = default;
+};
+
+void BenchPruning()
+{
+    auto Step = [](const FWalkState& State)
+    {
+        return Roll(4).Transform(
+            [&State](int Direction)
+            {
+                return FWalkState{ State.X + (Direction == 1) - (Direction == 2),
+                                   State.Y + (Direction == 3) - (Direction == 4) };
+            });
+    };
+    auto Summary = [](const TDDist<FWalkState>& Dist)
+    {
+        return std::to_string(Dist.PDF.size()) +
+               " atoms, discarded " + std::to_string(Dist.Discarded);
+    };
+
+    std::cout << "RandomWalk(200)" << std::endl;
+    Time("Exact", [&] { return Summary(iterate(FWalkState{ 0, 0 }, Step, 200)); });
+    Time("Threshold 1e-9",
+         [&]
+         {
+             return Summary(
+                 iterate(FWalkState{ 0, 0 }, Step, 200, FPruning{ 1e-9 }));
+         });
+    Time("Top 2000",
+         [&]
+         {
+             return Summary(
+                 iterate(FWalkState{ 0, 0 }, Step, 200, FPruning{ 0, 2000 }));
+         });
+}
+
+void BenchInterned()
+{
+    const auto Start = Roll(20000).Transform([](int x) { return x % 997; });
+
+    std::cout << "Roll(20) >= ToHit in each of 20000 continuations"
+              << std::endl;
+    Time("Rebuilt",
+         [&]
+         {
+             return Start
+                 .AndThen([](int x)
+                          { return (Roll(20) >= x % 20).Transform(
+                                [x](bool b) { return b ? x : 0; }); })
+                 .PDF.size();
+         });
+    Time("Interned",
+         [&]
+         {
+             return Start
+                 .AndThen(
+                     [](int x)
+                     {
+                         return Interned([](int ToHit)
+                                         { return Roll(20) >= ToHit; },
+                                         x % 20)
+                             ->Transform([x](bool b) { return b ? x : 0; });
+                     })
+                 .PDF.size();
+         });
+
+    std::cout << "Roll(6) in each of 20000 continuations" << std::endl;
+    Time("Rebuilt",
+         [&]
+         {
+             return Start
+                 .AndThen([](int x)
+                          { return Roll(6).Transform([x](int y) { return x + y; }); })
+                 .PDF.size();
+         });
+    Time("Interned",
+         [&]
+         {
+             return Start
+                 .AndThen([](int x) {
+                     return InternedRoll(6)->Transform([x](int y) { return x + y; });
+                 })
+                 .PDF.size();
+         });
+}
+
+void BenchMemo()
+{
+    auto Cheap = [](int x)
+    { return Roll(4).Transform([x](int y) { return (x + y) % 1000; }); };
+    auto Costly = [](int x)
+    {
+        return (Roll(6) + Roll(6) + Roll(6))
+            .Transform([x](int y) { return (x + y) % 1000; });
+    };
+
+    auto Run = [](const auto& Step)
+    {
+        auto Dist = Certainly(0);
+        for (int T = 0; T < 200; ++T)
+        {
+            Dist = std::move(Dist).AndThen(Step);
+        }
+        return Dist.PDF.size();
+    };
+
+    std::cout << "200 steps round a ring of 1000 states" << std::endl;
+    Time("Roll(4)", [&] { return Run(Cheap); });
+    Time("Roll(4), Memo", [&] { return Run(Memo<int>(Cheap)); });
+    Time("3d6", [&] { return Run(Costly); });
+    auto Step = Memo<int>(Costly);
+    Time("3d6, Memo", [&] { return Run(Step); });
+    std::cout << "  " << Step.Stats().Hits << " hits, "
+              << Step.Stats().Misses << " misses" << std::endl;
+}
+
+void BenchAbsorbing()
+{
+    auto Step = [](const std::pair<int, int>& State)
+    {
+        if (State.first <= 0)
+        {
+            return Certainly(State);
+        }
+        return Roll(6).Transform(
+            [&State](int Value)
+            {
+                return std::pair{ std::max(0, State.first - Value),
+                                  State.second + 1 };
+            });
+    };
+    auto IsDone = [](const std::pair<int, int>& State)
+    { return State.first <= 0; };
+
+    std::cout << "TimeToHitZero(1000) with absorbing states" << std::endl;
+    Time("Expand all",
+         [&] { return iterate(std::pair{ 1000, 0 }, Step, 1000).PDF.size(); });
+    Time("Frontier only",
+         [&]
+         {
+             return iterate(std::pair{ 1000, 0 }, Step, 1000, IsDone)
+                 .PDF.size();
+         });
+}
+
+struct FFightState
+{
+    int A;
+    int B;
+    int Potions;
+
+    auto operator<=>(const FFightState& Other) const = default;
+};
+
+template<> struct TStateCodec<FFightState> : TMixedRadix<41, 41, 3>
+{
+    static FDigits ToDigits(const FFightState& State)
+    {
+        return { State.A, State.B, State.Potions };
+    }
+
+    static FFightState FromDigits(const FDigits& Digits)
+    {
+        return { Digits[0], Digits[1], Digits[2] };
+    }
+};
+
+void BenchTensor()
+{
+    auto Round = [](const FFightState& State)
+    {
+        if (State.A == 0 || State.B == 0)
+        {
+            return Certainly(State);
+        }
+        if (State.A < 10 && State.Potions > 0)
+        {
+            return Roll(8).Transform(
+                [State](int Healed)
+                {
+                    return FFightState{ std::min(40, State.A + Healed),
+                                        State.B,
+                                        State.Potions - 1 };
+                });
+        }
+        return Roll(6).AndThen(
+            [State](int HitA)
+            {
+                return Roll(8).Transform(
+                    [State, HitA](int HitB)
+                    {
+                        return FFightState{ std::max(0, State.A - HitB),
+                                            std::max(0, State.B - HitA),
+                                            State.Potions };
+                    });
+            });
+    };
+
+    std::cout << "30 rounds over 41 x 41 x 3 states" << std::endl;
+    Time("TDist",
+         [&]
+         {
+             TDDist<FFightState> Dist = Certainly(FFightState{ 40, 40, 2 });
+             for (int T = 0; T < 30; ++T)
+             {
+                 Dist = std::move(Dist).AndThen(Round);
+             }
+             return Dist.PDF.size();
+         });
+    Time("TTensorDist",
+         [&]
+         {
+             TTensorDist<double, FFightState> Dist =
+                 Certainly(FFightState{ 40, 40, 2 });
+             for (int T = 0; T < 30; ++T)
+             {
+                 Dist = Dist.AndThen(Round);
+             }
+             return Dist.ToDist().PDF.size();
+         });
+
+    std::cout << "Damage to B, 1000 times" << std::endl;
+    TTensorDist<double, FFightState> Start = Certainly(FFightState{ 40, 40, 2 });
+    for (int T = 0; T < 10; ++T)
+    {
+        Start = Start.AndThen(Round);
+    }
+    const TDDist<FFightState> SparseStart = Start;
+    auto Damage = [](int HP)
+    { return Roll(6).Transform([HP](int x) { return std::max(0, HP - x); }); };
+    Time("UpdateFieldP",
+         [&]
+         {
+             std::size_t Size = 0;
+             for (int T = 0; T < 1000; ++T)
+             {
+                 Size += SparseStart
+                             .AndThen(
+                                 [&](const FFightState& State) {
+                                     return UpdateFieldP(
+                                         State, &FFightState::B, Damage(State.B));
+                                 })
+                             .PDF.size();
+             }
+             return Size;
+         });
+    Time("UpdateField",
+         [&]
+         {
+             double Total = 0;
+             for (int T = 0; T < 1000; ++T)
+             {
+                 Total += Start.UpdateField(1, Damage).Probs[0];
+             }
+             return Total;
+         });
+}
+
+void BenchProduct()
+{
+    std::cout << "Six independent d6, then compare the first two" << std::endl;
+    Time("sequence",
+         []
+         {
+             std::vector<TDist<double, int>> Dice(6, Roll(6));
+             return sequence(Dice)
+                 .Transform([](const std::vector<int>& Values)
+                            { return Values[0] > Values[1]; })
+                 .PDF.size();
+         });
+    Time("Product",
+         []
+         {
+             auto d6 = Roll(6);
+             return Product(d6, d6, d6, d6, d6, d6)
+                 .Apply<0, 1>([](int x, int y) { return Certainly(x > y); })
+                 .PDF.size();
+         });
+}
+
+struct FWalkerPair
+{
+    int A;
+    int B;
+
+    auto operator<=>(const FWalkerPair& Other) const = default;
+};
+
+// The same walkers when only the set of positions matters.
+struct FWalkerSet
+{
+    int A;
+    int B;
+
+    auto operator<=>(const FWalkerSet& Other) const = default;
+
+    FWalkerSet Canonicalise() const { return B < A ? FWalkerSet{ B, A } : *this; }
+};
+
+void BenchSymmetry()
+{
+    auto Step = []<typename StateType>(const StateType& State)
+    {
+        return Roll(3).AndThen(
+            [State](int MoveA)
+            {
+                return Roll(3).Transform(
+                    [State, MoveA](int MoveB)
+                    {
+                        return StateType{ (State.A + MoveA + 98) % 100,
+                                          (State.B + MoveB + 98) % 100 };
+                    });
+            });
+    };
+
+    std::cout << "Two walkers on a ring of 100, 60 steps" << std::endl;
+    Time("Ordered pair",
+         [&] { return iterate(FWalkerPair{ 0, 50 }, Step, 60).PDF.size(); });
+    Time("Symmetric",
+         [&] { return iterate(FWalkerSet{ 0, 50 }, Step, 60).PDF.size(); });
+}
+
+struct FUnkeyedPoint
+{
+    int X;
+    int Y;
+
+    auto operator<=>(const FUnkeyedPoint& Other) const = default;
+};
+
+struct FKeyedPoint
+{
+    int X;
+    int Y;
+
+    auto operator<=>(const FKeyedPoint& Other) const = default;
+
+    std::uint64_t GetSortKey() const { return PackSortKey(X, Y); }
+};
+
+void BenchRadixSort()
+{
+    auto Scrambled = []<typename PointType>(std::size_t NumAtoms)
+    {
+        TDDist<PointType> Dist{};
+        std::uint64_t     Seed = 1;
+        for (std::size_t I = 0; I < NumAtoms; ++I)
+        {
+            Seed = Seed * 6364136223846793005ull + 1442695040888963407ull;
+            const int X = static_cast<int>(Seed >> 40) % 2000 - 1000;
+            const int Y = static_cast<int>(Seed >> 20 & 0xfffff) % 2000 - 1000;
+            Dist.PDF.push_back(TAtom<double, PointType>{ PointType{ X, Y }, 1.0 });
+        }
+        return Dist;
+    };
+
+    for (std::size_t NumAtoms : { 10000, 1000000, 10000000 })
+    {
+        std::cout << "canonicalise() on " << NumAtoms << " scrambled points"
+                  << std::endl;
+        auto Unkeyed = Scrambled.template operator()<FUnkeyedPoint>(NumAtoms);
+        auto Keyed = Scrambled.template operator()<FKeyedPoint>(NumAtoms);
+        Time("std::sort",
+             [&]
+             {
+                 Unkeyed.canonicalise();
+                 return Unkeyed.PDF.size();
+             });
+        Time("Radix sort",
+             [&]
+             {
+                 Keyed.canonicalise();
+                 return Keyed.PDF.size();
+             });
+    }
+}
+
+struct FWalkerPoint
+{
+    int X;
+    int Y;
+
+    auto operator<=>(const FWalkerPoint& Other) const = default;
+
+    std::size_t GetTypeHash() const { return HashCombine(X, Y); }
+};
+
+template<typename P> TDist<P, FWalkerPoint> FloatWalk(int N)
+{
+    return iterate<P>(
+        FWalkerPoint{ 0, 0 },
+        [](const FWalkerPoint& State)
+        {
+            return Roll<P>(4).Transform(
+                [State](int Direction)
+                {
+                    return FWalkerPoint{ State.X + (Direction == 1) - (Direction == 2),
+                                         State.Y + (Direction == 3) - (Direction == 4) };
+                });
+        },
+        N);
+}
+
+template<typename P> TDist<P, int> FloatRing(int N)
+{
+    return iterate_matrix_i<P>(
+        0,
+        [](int X)
+        {
+            return Roll<P>(3).Transform([X](int Move) { return (X + Move + 98) % 100; });
+        },
+        N);
+}
+
+// Largest difference in probability between a `float` and a `double`
+// distribution over the same values.
+template<typename ValueType>
+double MaxError(const TDist<float, ValueType>& Single, const TDist<double, ValueType>& Double)
+{
+    double Error = 0;
+    std::size_t I = 0;
+    for (const auto& [Value, Prob] : Double.PDF)
+    {
+        const bool bFound = I < Single.PDF.size() && Single.PDF[I].Value == Value;
+        Error = std::max(Error, std::abs((bFound ? Single.PDF[I++].Prob : 0.0f) - Prob));
+    }
+    return Error;
+}
+
+template<typename P, typename ValueType> double TotalMass(const TDist<P, ValueType>& Dist)
+{
+    double Total = 0;
+    for (const auto& Atom : Dist.PDF)
+    {
+        Total += Atom.Prob;
+    }
+    return Total;
+}
+
+void BenchFloat()
+{
+    std::cout << "Atom size: float " << sizeof(TAtom<float, FWalkerPoint>)
+              << " bytes, double " << sizeof(TAtom<double, FWalkerPoint>) << " bytes"
+              << std::endl;
+
+    std::cout << "Random walk, 200 steps" << std::endl;
+    TDist<double, FWalkerPoint> Walk{};
+    TDist<float, FWalkerPoint>  WalkF{};
+    Time("double", [&] { Walk = FloatWalk<double>(200); return Walk.PDF.size(); });
+    Time("float", [&] { WalkF = FloatWalk<float>(200); return WalkF.PDF.size(); });
+    std::cout << "  max error " << MaxError(WalkF, Walk) << ", total mass "
+              << TotalMass(WalkF) << std::endl;
+
+    std::cout << "Ring of 100 by matrix, 10000 steps" << std::endl;
+    TDist<double, int> Ring{};
+    TDist<float, int>  RingF{};
+    Time("double", [&] { Ring = FloatRing<double>(10000); return Ring.PDF.size(); });
+    Time("float", [&] { RingF = FloatRing<float>(10000); return RingF.PDF.size(); });
+    std::cout << "  max error " << MaxError(RingF, Ring) << ", total mass "
+              << TotalMass(RingF) << std::endl;
+}
+
+template<typename P> TDist<P, int> ExactCountdown(int N)
+{
+    return iterate<P>(
+        3 * N,
+        [](int X)
+        {
+            return X == 0 ? Certainly<P>(0)
+                          : Roll<P>(6).Transform([X](int Y) { return std::max(0, X - Y); });
+        },
+        N);
+}
+
+void BenchExact()
+{
+    for (int NumDice : { 20, 200 })
+    {
+        std::cout << "Roll(" << NumDice << ", 6)" << std::endl;
+        Time("double", [&] { return Roll(NumDice, 6).PDF.size(); });
+        Time("FExactProb",
+             [&] { return Roll<FExactProb>(NumDice, 6).PDF.size(); });
+    }
+
+    std::cout << "Countdown from 60 by d6, 20 steps" << std::endl;
+    TDist<double, int>     Countdown{};
+    TDist<FExactProb, int> ExactCountdownDist{};
+    Time("double", [&] { Countdown = ExactCountdown<double>(20); return Countdown.PDF.size(); });
+    Time("FExactProb",
+         [&]
+         {
+             ExactCountdownDist = ExactCountdown<FExactProb>(20);
+             return ExactCountdownDist.PDF.size();
+         });
+    std::cout << "  P(0) = " << ExactCountdownDist.PDF[0].Prob << ", double error "
+              << std::abs(ExactCountdownDist.PDF[0].Prob.ToDouble() - Countdown.PDF[0].Prob)
+              << std::endl;
+}
+
+int main()
+{
+    BenchMergeStrategies();
+    BenchConvolution();
+    BenchParallel();
+    BenchSoA();
+    BenchInlineAtoms();
+    BenchArena();
+    BenchMoveAndThen();
+    BenchLazy();
+    BenchOrderedTransform();
+    BenchPruning();
+    BenchInterned();
+    BenchMemo();
+    BenchAbsorbing();
+    BenchTensor();
+    BenchProduct();
+    BenchSymmetry();
+    BenchRadixSort();
+    BenchFloat();
+    BenchExact();
+}
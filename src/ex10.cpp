@@ -1,40 +1,61 @@
+#include <algorithm>
 #include <iostream>
 
 #include "ChanceScript.h"
 
 // See https://www.explainxkcd.com/wiki/index.php/3015:_D%26D_Combinatorics
 
-auto GrabArrows(int NumArrows, int NumCursed, int NumToPick)
+struct FQuiver
 {
-    using FQuiver = std::vector<bool>;
+    std::vector<bool> Arrows;
+
+    auto operator<=>(const FQuiver&) const = default;
 
-    FQuiver StartQuiver(NumArrows, false);
-    std::fill(StartQuiver.begin(), StartQuiver.begin() + NumCursed, true);
+    // Arrows are only told apart by whether they're cursed, so only keep the
+    // quiver with its arrows sorted.
+    FQuiver Canonicalise() const
+    {
+        FQuiver Sorted = *this;
+        std::sort(Sorted.Arrows.begin(), Sorted.Arrows.end());
+        return Sorted;
+    }
+};
+
+auto GrabArrows(int NumArrows, int NumCursed, int NumToPick)
+{
+    FQuiver StartQuiver{ std::vector<bool>(NumArrows, false) };
+    std::fill(StartQuiver.Arrows.begin(),
+              StartQuiver.Arrows.begin() + NumCursed,
+              true);
 
     auto Quivers = Certainly(StartQuiver);
 
     for (int I = 0; I < NumToPick; ++I)
     {
         Quivers = Quivers.AndThen(
-            [](FQuiver Quiver)
+            [](const FQuiver& Quiver)
             {
-                int NumArrowsLeft = Quiver.size();
+                int NumArrowsLeft = Quiver.Arrows.size();
                 return Roll(NumArrowsLeft)
                     .Transform(
                         [&Quiver](const int Pick)
                         {
                             // Remove arrow and replace it with one from end
                             FQuiver NewQuiver = Quiver;
-                            NewQuiver[Pick - 1] = NewQuiver.back();
-                            NewQuiver.pop_back();
+                            NewQuiver.Arrows[Pick - 1] = NewQuiver.Arrows.back();
+                            NewQuiver.Arrows.pop_back();
                             return NewQuiver;
                         });
             });
+        Quivers.ReduceSymmetry();
     }
 
     auto WasACursedOnePicked = Quivers.Transform(
         [NumCursed](const FQuiver& Quiver)
-        { return std::count(Quiver.begin(), Quiver.end(), true) < NumCursed; });
+        {
+            return std::count(Quiver.Arrows.begin(), Quiver.Arrows.end(), true) <
+                   NumCursed;
+        });
 
     return WasACursedOnePicked;
 }
@@ -3,7 +3,7 @@
 
 #include "ChanceScript.h"
 
-int SumOf(FSampler& Sampler, int N)
+int SumOfRolls(FSampler& Sampler, int N)
 {
     int Total = 0;
 
@@ -17,7 +17,7 @@ int SumOf(FSampler& Sampler, int N)
 
 int main()
 {
-    auto Dist = MakeDDist(SumOf, 6);
+    auto Dist = MakeDDist(SumOfRolls, 6);
 
     for (auto [Value, Prob] : Dist)
     {
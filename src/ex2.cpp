@@ -90,6 +90,14 @@ struct FState
 
     auto operator<=>(const FState&) const = default;
 
+    // The ogres are identical and a round treats them alike, so only keep
+    // states with the weaker one second, the order the players' focus on the
+    // weaker ogre produces anyway.
+    FState Canonicalise() const
+    {
+        return Ogre1 < Ogre2 ? FState{ Fighter, Cleric, Ogre2, Ogre1 } : *this;
+    }
+
     bool GameOver() const
     {
         return !Ogre1.IsAlive() && !Ogre2.IsAlive() ||
@@ -117,12 +125,12 @@ struct FState
     {
         if (Attacker.HitPoints > 0)
         {
-            // Note it is more efficient to perform the `Roll(2) >= ToHit` first
+            // Note it is more efficient to perform the `Roll(20) >= ToHit` first
             // than put the comparison inside the `.AndThen()` as this results
             // in the lambda in `.AndThen()` being called just twice instead
             // of 20 times. Always reduce the space as early as possible.
-            return (Roll(20) >= ToHit)
-                .AndThen(
+            return Interned([](int ToHit) { return Roll(20) >= ToHit; }, ToHit)
+                ->AndThen(
                     [&DamageRoll, &Attacker, &Defender](
                         const bool bAttackerHits)
                     {
@@ -148,6 +156,29 @@ struct FState
     }
 };
 
+// Every field of the state is bounded so its distributions can be stored
+// densely, one probability per state.
+template<> struct TStateCodec<FState>
+    : TMixedRadix<FighterFullHP + 1, ClericFullHP + 1, 3, 20, 20>
+{
+    static FDigits ToDigits(const FState& State)
+    {
+        return { State.Fighter.HitPoints,
+                 State.Cleric.HitPoints,
+                 State.Cleric.NumCureLightWounds,
+                 State.Ogre1.HitPoints,
+                 State.Ogre2.HitPoints };
+    }
+
+    static FState FromDigits(const FDigits& Digits)
+    {
+        return FState{ FFighter(Digits[0]),
+                       FCleric(Digits[1], Digits[2]),
+                       FOgre(Digits[3]),
+                       FOgre(Digits[4]) };
+    }
+};
+
 TDDist<FState> FFighter::DoMove(const FState& State) const
 {
     if (!State.GameOver() && HitPoints > 0)
@@ -237,19 +268,22 @@ void test()
     };
 
 #if 1
-    TDDist<FState> r = iterate_matrix_i(
-        State,
-        [](const FState State)
-        {
-            return State.Fighter.DoMove(State)
-                .AndThen([](const FState& State)
-                         { return State.Cleric.DoMove(State); })
-                .AndThen([](const FState& State)
-                         { return State.Ogre1.DoMove(State); })
-                .AndThen([](const FState& State)
-                         { return State.Ogre2.DoMove(State); });
-        },
-        50);
+    TTensorDist<double, FState> Dense = Certainly(State);
+    for (int Round = 0; Round < 50; ++Round)
+    {
+        Dense = Dense
+                    .AndThen([](const FState& State)
+                             { return State.Fighter.DoMove(State); })
+                    .AndThen([](const FState& State)
+                             { return State.Cleric.DoMove(State); })
+                    .AndThen([](const FState& State)
+                             { return State.Ogre1.DoMove(State); })
+                    .AndThen([](const FState& State)
+                             { return State.Ogre2.DoMove(State); });
+        Dense.ReduceSymmetry();
+    }
+    TDDist<FState> r = Dense;
+    std::cout << r.PDF.size() << " states" << std::endl;
 #else
     TDDist<FState> r = iterate_matrix_inf(
         State,
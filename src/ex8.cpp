@@ -12,8 +12,6 @@ auto TimeToHitZero(int N)
         auto operator<=>(const FState& Other) const = default;
     };
 
-    auto Dist = Certainly(FState{ N, 0 });
-
     // In 'normal' code we'd write:
     //
     // for (int T = 0; T < N; ++T)
@@ -34,27 +32,27 @@ auto TimeToHitZero(int N)
     // No need to keep tracking the probability of every individual state with
     // N < 0.
 
-    for (int T = 0; T < N; ++T)
+    // Once N reaches zero a state never changes again, so `TFrontier` sets it
+    // aside rather than passing it through every later step.
+    TFrontier Frontier(Certainly(FState{ N, 0 }),
+                       [](const FState& State) { return State.N <= 0; });
+
+    for (int T = 0; T < N && !Frontier.Live.PDF.empty(); ++T)
     {
-        Dist = Dist.AndThen(
+        Frontier.Step(
             [](const auto& State)
             {
-                if (State.N <= 0)
-                {
-                    return Certainly(State);
-                }
-                else
-                {
-                    return Roll(6).Transform(
-                        [&State](int Value)
-                        {
-                            return FState{ std::max(0, State.N - Value),
-                                           State.Count + 1 };
-                        });
-                }
+                return Roll(6).Transform(
+                    [&State](int Value)
+                    {
+                        return FState{ std::max(0, State.N - Value),
+                                       State.Count + 1 };
+                    });
             });
     }
 
+    auto Dist = std::move(Frontier).Result();
+
     return Dist.Transform([](const auto& State) { return State.Count; });
 }
 
@@ -16,7 +16,7 @@ auto RandomWalk(int N)
 
     for (int T = 0; T < N; ++T)
     {
-        Dist = Dist.AndThen(
+        Dist = std::move(Dist).AndThen(
             [](const auto& State)
             {
                 return Roll(4).Transform(
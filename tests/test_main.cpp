@@ -2,6 +2,29 @@
 
 #include "ChanceScript.h"
 
+// Expects `A` and `B` to hold the same values in the same order, with
+// probabilities within `Tolerance` of each other.
+template<typename PA, typename PB, typename X>
+void ExpectSameDist(const TDist<PA, X>& A, const TDist<PB, X>& B,
+                    double Tolerance) {
+  ASSERT_EQ(A.PDF.size(), B.PDF.size());
+  for (std::size_t i = 0; i < A.PDF.size(); ++i) {
+    EXPECT_EQ(A.PDF[i].Value, B.PDF[i].Value);
+    EXPECT_NEAR(static_cast<double>(A.PDF[i].Prob),
+                static_cast<double>(B.PDF[i].Prob), Tolerance);
+  }
+}
+
+// As above, with probabilities that must be exactly equal.
+template<typename P, typename X>
+void ExpectSameDist(const TDist<P, X>& A, const TDist<P, X>& B) {
+  ASSERT_EQ(A.PDF.size(), B.PDF.size());
+  for (std::size_t i = 0; i < A.PDF.size(); ++i) {
+    EXPECT_EQ(A.PDF[i].Value, B.PDF[i].Value);
+    EXPECT_EQ(A.PDF[i].Prob, B.PDF[i].Prob);
+  }
+}
+
 TEST(ChanceScript, test1) {
   auto d = Roll(6);
   double total = 0.0;
@@ -49,6 +72,1089 @@ TEST(ChanceScript, test4) {
   }
 }
 
+TEST(ChanceScript, test5) {
+  struct FState
+  {
+    int X;
+    int Y;
+
+    auto operator<=>(const FState&) const = default;
+
+    std::size_t GetTypeHash() const { return HashCombine(X, Y); }
+  };
+
+  auto Step = [](const FState& State) {
+    return Roll(4).Transform([&State](int Direction) {
+      return Direction <= 2 ? FState{ State.X + 2 * Direction - 3, State.Y }
+                            : FState{ State.X, State.Y + 2 * Direction - 7 };
+    });
+  };
+
+  auto Sorted = Certainly(FState{ 0, 0 });
+  auto Hashed = Sorted;
+  for (int T = 0; T < 10; ++T)
+  {
+    Sorted = Sorted.AndThen(Step);
+    Hashed = Hashed.AndThen(Step, EMergeStrategy::Hash);
+  }
+
+  ExpectSameDist(Sorted, Hashed, 1e-15);
+}
+
+TEST(ChanceScript, test6) {
+  // `std::vector` is hashed through `TValueHash<>`. `std::pair` has no
+  // hash, so it falls back to sorting.
+  static_assert(CHashable<std::vector<int>>);
+  static_assert(!CHashable<std::pair<int, int>>);
+  auto d = Roll(6).Transform([](int x) { return std::vector<int>{ x % 3 }; },
+                             EMergeStrategy::Hash);
+  auto e = Roll(6).Transform([](int x) { return std::pair<int, int>{ x % 2, 0 }; },
+                             EMergeStrategy::Hash);
+
+  ASSERT_EQ(d.PDF.size(), 3);
+  ASSERT_EQ(e.PDF.size(), 2);
+  for (auto [x, p] : d.PDF)
+  {
+    EXPECT_FLOAT_EQ(p, 1 / 3.);
+  }
+  EXPECT_FLOAT_EQ(e.PDF[0].Prob, 0.5);
+}
+
+TEST(ChanceScript, test7) {
+  auto f = [](int x) {
+    return x % 3 == 0 ? Certainly(x) : Roll(x).Transform([](int y) { return y / 2; });
+  };
+  auto Sorted = Roll(20).AndThen(f);
+  auto Merged = Roll(20).AndThen(f, EMergeStrategy::KWayMerge);
+
+  ExpectSameDist(Sorted, Merged, 1e-15);
+}
+
+TEST(ChanceScript, test8) {
+  TDenseDist<double, int> d = Roll(6);
+  EXPECT_EQ(d.Min, 1);
+  ASSERT_EQ(d.Probs.size(), 6);
+
+  TDist<double, int> e = (d + Roll(6) + 10).AndThen([](int x) {
+    return x % 2 == 0 ? Certainly(x / 2) : Roll(2) + x;
+  });
+  TDist<double, int> f = (Roll(6) + Roll(6) + 10).AndThen([](int x) {
+    return x % 2 == 0 ? Certainly(x / 2) : Roll(2) + x;
+  });
+
+  ExpectSameDist(e, f, 1e-15);
+
+  auto g = (2 * d).Transform([](int x) { return -x; });
+  ASSERT_EQ(g.PDF.size(), 6);
+  EXPECT_EQ(g.PDF[0].Value, -12);
+  EXPECT_DOUBLE_EQ(g.PDF[0].Prob, 1 / 6.);
+  EXPECT_EQ(g.PDF[1].Value, -10);
+
+  // Results spread too thinly for an array come back sorted instead.
+  auto Wide = 100000000 * d;
+  ASSERT_EQ(Wide.PDF.size(), 6);
+  EXPECT_EQ(Wide.PDF.back().Value, 600000000);
+  auto Extremes = d.Transform([](int x) { return x < 4 ? -2000000000 : 2000000000; });
+  ASSERT_EQ(Extremes.PDF.size(), 2);
+  EXPECT_DOUBLE_EQ(Extremes.PDF[0].Prob, 0.5);
+  auto Spread = d.AndThen([](int x) { return Certainly(x * 300000000); });
+  ASSERT_EQ(Spread.PDF.size(), 6);
+  EXPECT_EQ(Spread.PDF[2].Value, 900000000);
+
+  // Sums with sparse distributions aren't spread over an array either, and
+  // sparse distributions can't be made dense.
+  auto Tens = Roll(2).Transform([](int x) { return x * 1000000000; });
+  TDist<double, int> Sparse = d + Tens;
+  ASSERT_EQ(Sparse.PDF.size(), 12);
+  EXPECT_EQ(Sparse.PDF.back().Value, 2000000006);
+  EXPECT_DOUBLE_EQ(Sparse.PDF.back().Prob, 1 / 12.);
+  TDist<double, int> Reversed = Tens + d;
+  EXPECT_EQ(Reversed.PDF.size(), 12);
+  EXPECT_THROW((TDenseDist<double, int>(Tens)), std::length_error);
+}
+
+TEST(ChanceScript, test9) {
+  // Sparse integer values still sort rather than bucket.
+  auto d = Roll(6).Transform([](int x) { return x * 1000000; }) + Roll(2);
+
+  ASSERT_EQ(d.PDF.size(), 12);
+  EXPECT_EQ(d.PDF.front().Value, 1000001);
+  EXPECT_EQ(d.PDF.back().Value, 6000002);
+  for (auto [x, p] : d.PDF)
+  {
+    EXPECT_DOUBLE_EQ(p, 1 / 12.);
+  }
+}
+
+TEST(ChanceScript, test10) {
+  std::vector<double> a(300), b(500);
+  for (std::size_t I = 0; I < a.size(); ++I) a[I] = (I % 7 + 1) / 1200.;
+  for (std::size_t I = 0; I < b.size(); ++I) b[I] = (I % 5 + 1) / 1500.;
+
+  auto Direct = ConvolveDirect(a, b);
+  auto FFT = ConvolveFFT(a, b);
+  ASSERT_EQ(Direct.size(), FFT.size());
+  for (std::size_t I = 0; I < Direct.size(); ++I)
+  {
+    EXPECT_NEAR(Direct[I], FFT[I], 1e-15);
+  }
+}
+
+TEST(ChanceScript, test11) {
+  auto d = Roll(3, 6);
+  auto e = fold(std::plus<>(), 0, std::vector{ Roll(6), Roll(6), Roll(6) });
+
+  ASSERT_EQ(d.PDF.size(), 16);
+  ExpectSameDist(d, e, 1e-15);
+  EXPECT_DOUBLE_EQ(d.PDF[0].Prob, 1 / 216.);
+  EXPECT_DOUBLE_EQ(d.PDF[7].Prob, 27 / 216.);
+}
+
+TEST(ChanceScript, test12) {
+  auto a = Roll(6);
+  auto b = Roll(4) + 1;
+  auto Pairs = [&](auto g) {
+    return a.AndThen([&](int x) { return b.Transform([&](int y) { return g(x, y); }); });
+  };
+
+  auto Highest = Max(a, b);
+  auto Lowest = Min(a, b);
+  auto ExpectedHighest = Pairs([](int x, int y) { return std::max(x, y); });
+  auto ExpectedLowest = Pairs([](int x, int y) { return std::min(x, y); });
+
+  ExpectSameDist(Highest, ExpectedHighest, 1e-15);
+  ExpectSameDist(Lowest, ExpectedLowest, 1e-15);
+}
+
+TEST(ChanceScript, test13) {
+  auto d20 = Roll(20);
+  auto Highest = reduce(3, cs::max(), d20);
+  auto Lowest = MinOf(5, d20);
+
+  for (auto [x, p] : Highest.PDF)
+  {
+    EXPECT_NEAR(p, (std::pow(x, 3) - std::pow(x - 1, 3)) / 8000., 1e-15);
+  }
+  for (auto [x, p] : Lowest.PDF)
+  {
+    EXPECT_NEAR(p, (std::pow(21 - x, 5) - std::pow(20 - x, 5)) / 3200000., 1e-15);
+  }
+
+  auto r = repeated(cs::max(), 3, Roll(6), 2);
+  EXPECT_DOUBLE_EQ(r.PDF.front().Prob, 9 / 36.);
+  EXPECT_EQ(r.PDF.front().Value, 3);
+}
+
+TEST(ChanceScript, test14) {
+  // Brute force: track every sorted kept vector.
+  auto Brute = [](int n, int k, auto compare) {
+    auto d = Certainly(std::vector<int>{});
+    for (int I = 0; I < n; ++I)
+    {
+      d = d.AndThen([&](const std::vector<int>& v) {
+        return Roll(4).Transform([&](int x) {
+          auto w = v;
+          w.insert(std::lower_bound(w.begin(), w.end(), x, compare), x);
+          if (w.size() > static_cast<std::size_t>(k)) w.pop_back();
+          return w;
+        });
+      });
+    }
+    return d;
+  };
+
+  for (auto [n, k] : { std::pair{ 5, 3 }, std::pair{ 2, 3 }, std::pair{ 6, 1 } })
+  {
+    auto Expected = Brute(n, k, std::greater<int>());
+    auto Actual = KeepHighest(n, k, Roll(4));
+    ExpectSameDist(Expected, Actual, 1e-15);
+
+    auto ExpectedLow = Brute(n, k, std::less<int>()).Transform(cs::sum);
+    auto ActualLow = KeepLowestSum(n, k, Roll(4));
+    ExpectSameDist(ExpectedLow, ActualLow, 1e-15);
+  }
+
+  // 4d6 drop lowest.
+  auto Stats = KeepHighestSum(4, 3, Roll(6));
+  EXPECT_EQ(Stats.PDF.front().Value, 3);
+  EXPECT_DOUBLE_EQ(Stats.PDF.front().Prob, 1 / 1296.);
+  EXPECT_DOUBLE_EQ(Stats.PDF.back().Prob, 21 / 1296.);
+}
+
+TEST(ChanceScript, test15) {
+  auto Expected = Certainly(0);
+  for (int I = 0; I < 13; ++I)
+  {
+    Expected = Expected + Roll(8);
+  }
+  auto Actual = Roll(13, 8);
+
+  ExpectSameDist(Expected, Actual, 1e-15);
+
+  auto Empty = SumOf(0, Roll(6));
+  ASSERT_EQ(Empty.PDF.size(), 1);
+  EXPECT_EQ(Empty.PDF[0].Value, 0);
+
+  // Non-integer values go through the generic addition.
+  auto Halves = SumOf(3, Roll(2).Transform([](int x) { return x / 2.; }));
+  ASSERT_EQ(Halves.PDF.size(), 4);
+  EXPECT_DOUBLE_EQ(Halves.PDF[1].Value, 2.);
+  EXPECT_DOUBLE_EQ(Halves.PDF[1].Prob, 3 / 8.);
+}
+
+TEST(ChanceScript, test16) {
+  auto a = Roll(6);
+  auto b = Roll(4) + 2;
+  auto Pairs = [&](auto g) {
+    return a.AndThen([&](int x) { return b.Transform([&](int y) { return g(x, y); }); });
+  };
+
+  ExpectSameDist(a <= b, Pairs([](int x, int y) { return x <= y; }), 1e-15);
+  ExpectSameDist(a >= b, Pairs([](int x, int y) { return x >= y; }), 1e-15);
+  ExpectSameDist(a < b, Pairs([](int x, int y) { return x < y; }), 1e-15);
+  ExpectSameDist(a > b, Pairs([](int x, int y) { return x > y; }), 1e-15);
+  ExpectSameDist(a == b, Pairs([](int x, int y) { return x == y; }), 1e-15);
+  ExpectSameDist(Roll(6) > 4, Roll(6).Transform([](int x) { return x > 4; }), 1e-15);
+
+  // Certain outcomes keep a single atom.
+  auto Never = Roll(6) > Roll(6) + 10;
+  ASSERT_EQ(Never.PDF.size(), 1);
+  EXPECT_FALSE(Never.PDF[0].Value);
+}
+
+TEST(ChanceScript, test17) {
+  // Enough atoms for many chunks, with continuations that overlap so the
+  // merge has equal values to sum.
+  auto Start = Roll(3000).Transform([](int x) { return x * 7 % 1999; });
+  auto Step = [](int x) {
+    return Roll(6).Transform([x](int y) { return (x * y) % 4001; });
+  };
+  auto Sequential = Start.AndThen(Step);
+
+  auto Reference = Start.AndThen(FParallel{ 1 }, Step);
+  ExpectSameDist(Reference, Sequential, 1e-15);
+
+  auto Half = [](int x) { return x / 2; };
+  auto ReferenceTransform = Start.Transform(FParallel{ 1 }, Half);
+  for (unsigned NumThreads : { 2u, 3u, 8u, 0u })
+  {
+    auto Actual = Start.AndThen(FParallel{ NumThreads }, Step);
+    ExpectSameDist(Actual, Reference);
+
+    auto Transformed = Start.Transform(FParallel{ NumThreads }, Half);
+    ExpectSameDist(Transformed, ReferenceTransform);
+  }
+
+  EXPECT_THROW(Start.AndThen(FParallel{ 4 },
+                             [](int x) -> TDist<double, int> {
+                               if (x == 5) throw std::runtime_error("x");
+                               return Certainly(x);
+                             }),
+               std::runtime_error);
+}
+
+TEST(ChanceScript, test18) {
+  // Lengths around the vector widths exercise the kernel tails.
+  for (std::size_t Count : { 0, 1, 3, 4, 5, 8, 9, 17, 100 })
+  {
+    std::vector<double> Probs(Count);
+    for (std::size_t I = 0; I < Count; ++I)
+    {
+      Probs[I] = I % 3 == 1 ? 0. : (I % 5 == 2 ? -1e-9 : 0.5 + I);
+    }
+
+    double Expected = 0;
+    for (double p : Probs) Expected += p;
+    EXPECT_NEAR(SumProbs(Probs.data(), Count), Expected, 1e-12);
+
+    for (std::size_t Begin = 0; Begin <= Count; ++Begin)
+    {
+      std::size_t Zero = Begin;
+      while (Zero < Count && Probs[Zero] != 0) ++Zero;
+      EXPECT_EQ(FindFirstZeroProb(Probs.data(), Begin, Count), Zero);
+
+      std::size_t Small = Begin;
+      while (Small < Count && std::abs(Probs[Small]) >= 1e-6) ++Small;
+      EXPECT_EQ(FindFirstSmallProb(Probs.data(), Begin, Count, 1e-6), Small);
+    }
+
+    auto Scaled = Probs;
+    ScaleProbs(Scaled.data(), Count, 0.25);
+    for (std::size_t I = 0; I < Count; ++I)
+    {
+      EXPECT_EQ(Scaled[I], Probs[I] * 0.25);
+    }
+  }
+}
+
+TEST(ChanceScript, test19) {
+  auto Step = [](int x) {
+    return Roll(6).Transform([x](int y) { return (x * y) % 17; });
+  };
+  auto Expected = Roll(20).AndThen(Step);
+
+  TSoADist<double, int> Start = Roll(20);
+  auto FromDist = Start.AndThen(Step);
+  auto FromSoA = Start.AndThen(
+    [&](int x) { return TSoADist<double, int>(Step(x)); });
+
+  for (const auto& Actual : { FromDist, FromSoA })
+  {
+    ExpectSameDist(Actual.ToDist(), Expected, 1e-15);
+    auto [Value, Prob] = *Actual.begin();
+    EXPECT_EQ(Value, Expected.PDF[0].Value);
+    EXPECT_NEAR(Prob, Expected.PDF[0].Prob, 1e-15);
+    EXPECT_NEAR(Actual.Total(), 1., 1e-12);
+  }
+
+  auto Halves = Start.Transform([](int x) { return x / 2; }).ToDist();
+  auto ExpectedHalves = Roll(20).Transform([](int x) { return x / 2; });
+  ExpectSameDist(Halves, ExpectedHalves, 1e-15);
+
+  TSoADist<double, int> Chopped({ 1, 2, 3, 4, 5 }, { 0.5, 1e-12, 0.25, 1e-13, 0.25 });
+  Chopped.chop(1e-9);
+  EXPECT_EQ(Chopped.Values, (std::vector<int>{ 1, 3, 5 }));
+  Chopped.Scale(2);
+  Chopped.Normalise();
+  EXPECT_EQ(Chopped.Probs, (std::vector<double>{ 0.5, 0.25, 0.25 }));
+}
+
+TEST(ChanceScript, test20) {
+  TSmallVector<int, 4> Small{ 1, 2, 3 };
+  EXPECT_TRUE(Small.IsInline());
+  Small.push_back(4);
+  EXPECT_TRUE(Small.IsInline());
+  Small.push_back(5);
+  EXPECT_FALSE(Small.IsInline());
+  EXPECT_EQ(Small.size(), 5);
+
+  Small.erase(Small.begin() + 1, Small.begin() + 3);
+  EXPECT_EQ(Small, (TSmallVector<int, 4>{ 1, 4, 5 }));
+  Small.insert(Small.begin() + 1, 2, 7);
+  EXPECT_EQ(Small, (TSmallVector<int, 4>{ 1, 7, 7, 4, 5 }));
+
+  auto Moved = std::move(Small);
+  EXPECT_EQ(Moved.size(), 5);
+  EXPECT_TRUE(Small.empty());
+  EXPECT_TRUE(Small.IsInline());
+
+  TSmallVector<std::vector<int>, 2> Vectors;
+  Vectors.emplace_back(3, 1);
+  auto Copy = Vectors;
+  auto Stolen = std::move(Vectors);
+  EXPECT_EQ(Copy[0], (std::vector<int>{ 1, 1, 1 }));
+  EXPECT_EQ(Stolen[0], Copy[0]);
+
+  // Small distributions don't allocate.
+  auto d = Roll(6) + 1;
+  EXPECT_TRUE(d.PDF.IsInline());
+  EXPECT_FALSE(Roll(1000).PDF.IsInline());
+  EXPECT_NEAR(Roll(1000).Transform([](int x) { return x % 7; }).PDF[3].Prob,
+              143. / 1000, 1e-15);
+}
+
+TEST(ChanceScript, test21) {
+  auto Step = [](int x) {
+    return Roll(6).Transform([x](int y) { return (x + y) % 97; });
+  };
+  auto Expected = Certainly(0);
+  for (int I = 0; I < 20; ++I) Expected = Expected.AndThen(Step);
+
+  auto Dist = Certainly(0);
+  {
+    FArenaScope Arena(256);
+    for (int I = 0; I < 20; ++I)
+    {
+      Arena.Release();
+      Dist = Dist.AndThen(Step);
+      EXPECT_NE(CurrentDistResource(), std::pmr::new_delete_resource());
+    }
+  }
+  EXPECT_EQ(CurrentDistResource(), std::pmr::new_delete_resource());
+  EXPECT_EQ(Dist.PDF.get_allocator().Resource, std::pmr::new_delete_resource());
+
+  auto Iterated = iterate(0, Step, 20);
+  for (const auto& Actual : { Dist, Iterated })
+  {
+    ExpectSameDist(Actual, Expected);
+  }
+
+  // The parallel reduction mustn't hand the arena to other threads.
+  FArenaScope Arena;
+  auto Parallel = Roll(3000).AndThen(FParallel{ 4 }, Step);
+  EXPECT_NEAR(Parallel.PDF[0].Prob, Roll(3000).AndThen(Step).PDF[0].Prob, 1e-15);
+}
+
+struct FCopyCounted
+{
+  static inline int Copies = 0;
+
+  int X;
+
+  FCopyCounted(int InX) : X(InX) {}
+  FCopyCounted(const FCopyCounted& Other) : X(Other.X) { ++Copies; }
+  FCopyCounted(FCopyCounted&&) = default;
+  FCopyCounted& operator=(const FCopyCounted& Other) { X = Other.X; ++Copies; return *this; }
+  FCopyCounted& operator=(FCopyCounted&&) = default;
+
+  auto operator<=>(const FCopyCounted&) const = default;
+};
+
+TEST(ChanceScript, test22) {
+  auto Step = [](int x) {
+    return Roll(6).Transform([x](int y) { return (x * 31 + y) % 211; });
+  };
+  auto Expected = Roll(100).AndThen(Step).Transform([](int x) { return x / 3; });
+  auto Moved = Roll(100);
+  Moved = std::move(Moved).AndThen(Step);
+  const auto* Buffer = Moved.PDF.data();
+  Moved = std::move(Moved).Transform([](int x) { return x / 3; });
+  EXPECT_EQ(Moved.PDF.data(), Buffer);
+  ExpectSameDist(Moved, Expected, 1e-15);
+
+  // Once the buffer has grown the loop reuses it.
+  auto Walk = Certainly(0);
+  for (int I = 0; I < 5; ++I) Walk = std::move(Walk) >> Step;
+  Buffer = Walk.PDF.data();
+  for (int I = 0; I < 5; ++I) Walk = std::move(Walk) >> Step;
+  EXPECT_EQ(Walk.PDF.data(), Buffer);
+
+  auto Counted = Roll(50).Transform([](int x) { return FCopyCounted(x % 7); });
+  FCopyCounted::Copies = 0;
+  auto Shifted = std::move(Counted).Transform(
+    [](FCopyCounted c) { return FCopyCounted(c.X + 1); });
+  auto Expanded = Shifted.AndThen([](const FCopyCounted& c) {
+    return Roll(2).Transform([&c](int y) { return FCopyCounted(c.X * y); });
+  });
+  EXPECT_EQ(FCopyCounted::Copies, 0);
+  EXPECT_EQ(Shifted.PDF.size(), 7);
+  EXPECT_EQ(Expanded.PDF.back().Value.X, 14);
+
+  TDist<double, int> Merged(std::vector<TAtom<double, int>>{ { 3, 0.25 }, { 1, 0.25 }, { 3, 0.5 } });
+  ASSERT_EQ(Merged.PDF.size(), 2);
+  EXPECT_EQ(Merged.PDF[1].Prob, 0.75);
+}
+
+TEST(ChanceScript, test23) {
+  auto Step = [](int x) {
+    return Roll(6).Transform([x](int y) { return (x * 7 + y) % 23; });
+  };
+  auto Double = [](int x) { return 2 * x; };
+  auto Expected = Roll(10).AndThen(Step).Transform(Double).Transform(
+    [](int x) { return x % 5; }).AndThen(Step);
+
+  const auto Start = Roll(10);
+  auto Pipeline = Start.Lazy().AndThen(Step).Transform(Double).Transform(
+    [](int x) { return x % 5; });
+  for (const auto& Actual : { Pipeline.AndThen(Step).Collect(),
+                              Pipeline.Merge().AndThen(Step).Collect(),
+                              Pipeline.AndThen(Step).Collect(EMergeStrategy::Hash),
+                              Roll(10).Lazy().AndThen(Step).Transform(Double)
+                                .Transform([](int x) { return x % 5; })
+                                .AndThen(Step).Collect() })
+  {
+    ExpectSameDist(Actual, Expected, 1e-15);
+  }
+
+  // Value types can change between stages.
+  auto Halves = Start.Lazy().Transform([](int x) { return x / 2.0; })
+    .Transform([](double x) { return x > 2; }).Collect();
+  ASSERT_EQ(Halves.PDF.size(), 2);
+  EXPECT_DOUBLE_EQ(Halves.PDF[1].Prob, 0.6);
+}
+
+TEST(ChanceScript, test24) {
+  auto d = Roll(10) + Roll(4);
+  auto Half = [](int x) { return x / 2; };
+  auto Negate = [](int x) { return -x; };
+  auto Shift = [](int x) { return x + 3; };
+  ExpectSameDist(d.TransformMonotone(Half), d.Transform(Half), 1e-15);
+  ExpectSameDist(d.TransformInjective(Negate), d.Transform(Negate), 1e-15);
+  ExpectSameDist(d.TransformStrictlyMonotone(Shift), d.Transform(Shift), 1e-15);
+
+  ExpectSameDist(d + 3, d.Transform(Shift), 1e-15);
+  ExpectSameDist(3 + d, d.Transform(Shift), 1e-15);
+  ExpectSameDist(-1 * d, d.Transform(Negate), 1e-15);
+  ExpectSameDist(0 * d, Certainly(0), 1e-15);
+  ExpectSameDist(d + 0.5, d.Transform([](int x) { return x + 0.5; }), 1e-15);
+  ExpectSameDist(d >= 7, d.Transform([](int x) { return x >= 7; }), 1e-15);
+  ExpectSameDist(d == 7, d.Transform([](int x) { return x == 7; }), 1e-15);
+  ExpectSameDist(d < 100, Certainly(true), 1e-15);
+
+#ifndef NDEBUG
+  EXPECT_DEATH(d.TransformStrictlyMonotone(Half), "");
+  EXPECT_DEATH(d.TransformMonotone(Negate), "");
+#endif
+}
+
+TEST(ChanceScript, test25) {
+  TDist<double, int> d(std::vector<TAtom<double, int>>{
+    { 1, 0.1 }, { 2, 0.3 }, { 3, 0.1 }, { 4, 0.4 }, { 5, 0.05 }, { 6, 0.05 } });
+  auto TopThree = d;
+  TopThree.Prune(FPruning{ 0, 3 });
+  ASSERT_EQ(TopThree.PDF.size(), 3);
+  EXPECT_EQ(TopThree.PDF[0].Value, 1);
+  EXPECT_EQ(TopThree.PDF[1].Value, 2);
+  EXPECT_EQ(TopThree.PDF[2].Value, 4);
+  EXPECT_NEAR(TopThree.Discarded, 0.2, 1e-15);
+
+  // Ties at the cutoff keep exactly `MaxAtoms`.
+  auto Tied = Roll(4);
+  Tied.Prune(FPruning{ 0, 2 });
+  EXPECT_EQ(Tied.PDF.size(), 2);
+  EXPECT_EQ(Tied.PDF[1].Value, 2);
+  EXPECT_DOUBLE_EQ(Tied.Discarded, 0.5);
+
+  auto Likely = d;
+  Likely.Prune(FPruning{ 0.08 });
+  EXPECT_EQ(Likely.PDF.size(), 4);
+  EXPECT_NEAR(Likely.Discarded, 0.1, 1e-15);
+
+  // The bound is carried through later operations.
+  auto Step = [](int x) {
+    return Roll(3).Transform([x](int y) { return x + y - 2; });
+  };
+  auto Later = Likely.AndThen(Step).Transform([](int x) { return x / 2; });
+  EXPECT_NEAR(Later.Discarded, 0.1, 1e-15);
+  EXPECT_NEAR((Likely + Likely).Discarded, 0.2, 1e-15);
+  EXPECT_NEAR((Likely >= Roll(6)).Discarded, 0.1, 1e-15);
+  EXPECT_NEAR(Likely.Lazy().AndThen(Step).Collect().Discarded, 0.1, 1e-15);
+  auto Nested = Roll(2).AndThen([&](int x) { return x == 1 ? Likely : Certainly(0); });
+  EXPECT_NEAR(Nested.Discarded, 0.05, 1e-15);
+
+  auto Exact = iterate(0, Step, 30);
+  auto Approx = iterate(0, Step, 30, FPruning{ 1e-4 });
+  EXPECT_LT(Approx.PDF.size(), Exact.PDF.size());
+  EXPECT_GT(Approx.Discarded, 0);
+  double Total = 0;
+  std::size_t J = 0;
+  for (const auto& [Value, Prob] : Approx)
+  {
+    while (Exact.PDF[J].Value < Value) ++J;
+    EXPECT_LE(Exact.PDF[J].Prob - Prob, Approx.Discarded + 1e-12);
+    EXPECT_GE(Exact.PDF[J].Prob - Prob, -1e-12);
+    Total += Prob;
+  }
+  EXPECT_NEAR(Total + Approx.Discarded, 1, 1e-12);
+}
+
+TEST(ChanceScript, test26) {
+  auto a = InternedRoll(6);
+  EXPECT_EQ(a, InternedRoll(6));
+  EXPECT_NE(a, InternedRoll(8));
+  ExpectSameDist(*a, Roll(6), 1e-15);
+  ExpectSameDist(*InternedRoll(2, 6), Roll(2, 6), 1e-15);
+
+  auto AtLeast = [](int ToHit) { return Roll(20) >= ToHit; };
+  TDistHandle<double, bool> Hit;
+  {
+    // Entries made inside an arena outlive it.
+    FArenaScope Arena;
+    Hit = Interned(AtLeast, 15);
+    EXPECT_EQ(Hit, Interned(AtLeast, 15));
+  }
+  ExpectSameDist(*Hit, Roll(20) >= 15, 1e-15);
+  EXPECT_NE(Hit, Interned(AtLeast, 16));
+
+  // A `Make` that throws leaves no entry behind, so the next call builds.
+  static bool bFail = true;
+  auto Flaky = [](int n) {
+    if (bFail) {
+      throw std::runtime_error("Flaky");
+    }
+    return Roll(n);
+  };
+  EXPECT_THROW(Interned(Flaky, 4), std::runtime_error);
+  bFail = false;
+  ASSERT_NE(Interned(Flaky, 4), nullptr);
+  ExpectSameDist(*Interned(Flaky, 4), Roll(4), 1e-15);
+}
+
+TEST(ChanceScript, test27) {
+  int Calls = 0;
+  auto Step = Memo<int>(
+      [&Calls](int x) {
+        ++Calls;
+        return Roll(2).Transform([x](int y) { return (x + y) % 5; });
+      },
+      3);
+
+  auto d = Certainly(0);
+  for (int i = 0; i < 10; ++i) {
+    d = std::move(d).AndThen(Step);
+  }
+  auto Expected = iterate(0, [](int x) {
+    return Roll(2).Transform([x](int y) { return (x + y) % 5; });
+  }, 10);
+  ExpectSameDist(d, Expected, 1e-15);
+
+  // Only five states exist but the cache holds three of them.
+  EXPECT_EQ(Step.size(), 3);
+  EXPECT_EQ(Step.Stats().Hits + Step.Stats().Misses, 1 + 2 + 3 + 4 + 5 * 6);
+  EXPECT_EQ(Step.Stats().Misses, Calls);
+  EXPECT_EQ(Step.Stats().Evictions, Calls - 3);
+  EXPECT_GT(Step.Stats().Hits, 0);
+
+  // A continuation that calls its own memo for other keys can't push the
+  // cache past its capacity.
+  std::function<TDist<double, int>(int)> Recurse;
+  auto Chain = Memo<int>(
+      [&Recurse](int x) {
+        return x == 0 ? Certainly(0)
+                      : Recurse(x - 1).Transform([](int y) { return y + 1; });
+      },
+      3);
+  Recurse = Chain;
+  EXPECT_EQ(Chain(10).PDF.front().Value, 10);
+  EXPECT_EQ(Chain.size(), 3);
+  Chain(20);
+  EXPECT_EQ(Chain.size(), 3);
+
+  // A continuation that throws leaves the cached results alone.
+  auto Flaky = Memo<int>(
+      [](int x) {
+        if (x == 1) {
+          throw std::runtime_error("Flaky");
+        }
+        return Certainly(x);
+      },
+      1);
+  Flaky(0);
+  EXPECT_THROW(Flaky(1), std::runtime_error);
+  EXPECT_EQ(Flaky.size(), 1);
+  Flaky(0);
+  EXPECT_EQ(Flaky.Stats().Hits, 1);
+  EXPECT_EQ(Flaky.Stats().Evictions, 0);
+
+  // Copies share the cache, and results made in an arena outlive it.
+  auto Copy = Step;
+  Step.clear();
+  {
+    FArenaScope Arena;
+    auto r = Copy(4);
+    EXPECT_EQ(r.PDF.size(), 2);
+  }
+  EXPECT_EQ(Step.size(), 1);
+  auto Again = Step(4);
+  EXPECT_EQ(Again.PDF[0].Value, 0);
+  EXPECT_EQ(Again.PDF[1].Value, 1);
+  EXPECT_EQ(Step.Stats().Misses, Calls);
+}
+
+TEST(ChanceScript, test28) {
+  // Counting down by 1..6 from 30, with 0 absorbing.
+  auto Step = [](const std::pair<int, int>& State) {
+    if (State.first == 0) {
+      return Certainly(State);
+    }
+    return Roll(6).Transform([&State](int x) {
+      return std::pair{ std::max(0, State.first - x), State.second + 1 };
+    });
+  };
+  auto IsDone = [](const std::pair<int, int>& State) { return State.first == 0; };
+
+  auto Exact = iterate(std::pair{ 30, 0 }, Step, 40);
+  auto Split = iterate(std::pair{ 30, 0 }, Step, 40, IsDone);
+  ExpectSameDist(Split, Exact, 1e-15);
+
+  // Part way through some mass is live and some settled.
+  TFrontier Frontier(Certainly(std::pair{ 30, 0 }), IsDone);
+  for (int i = 0; i < 8; ++i) {
+    Frontier.Step(Step);
+  }
+  EXPECT_FALSE(Frontier.Live.PDF.empty());
+  EXPECT_FALSE(Frontier.Settled.PDF.empty());
+  for (const auto& [Value, Prob] : Frontier.Live) {
+    EXPECT_NE(Value.first, 0);
+  }
+  auto Part = std::move(Frontier).Result();
+  auto PartExact = iterate(std::pair{ 30, 0 }, Step, 8);
+  ExpectSameDist(Part, PartExact, 1e-15);
+
+  // Steps can choose how `AndThen()` merges.
+  TFrontier Merged(Certainly(std::pair{ 30, 0 }), IsDone);
+  for (int i = 0; i < 8; ++i) {
+    Merged.Step(Step, EMergeStrategy::KWayMerge);
+  }
+  ExpectSameDist(std::move(Merged).Result(), PartExact, 1e-15);
+
+  // An absorbing start is never expanded.
+  int Calls = 0;
+  auto Counted = [&Calls](int x) { ++Calls; return Certainly(x); };
+  auto Stuck = iterate(0, Counted, 5, [](int x) { return x == 0; });
+  EXPECT_EQ(Calls, 0);
+  EXPECT_EQ(Stuck.PDF.size(), 1);
+}
+
+struct FDuel {
+  int A;
+  int B;
+  auto operator<=>(const FDuel&) const = default;
+};
+
+template<> struct TStateCodec<FDuel> : TMixedRadix<11, 9> {
+  static FDigits ToDigits(const FDuel& Duel) { return { Duel.A, Duel.B }; }
+  static FDuel FromDigits(const FDigits& Digits) { return { Digits[0], Digits[1] }; }
+};
+
+TEST(ChanceScript, test29) {
+  EXPECT_EQ(TStateCodec<FDuel>::Size, 99);
+  EXPECT_EQ(TStateCodec<FDuel>::Encode({ 3, 4 }), 31);
+  EXPECT_EQ(TStateCodec<FDuel>::Decode(31)[0], 3);
+  EXPECT_EQ(TStateCodec<FDuel>::Decode(31)[1], 4);
+
+  auto Round = [](const FDuel& Duel) {
+    if (Duel.A == 0 || Duel.B == 0) {
+      return Certainly(Duel);
+    }
+    return Roll(3).AndThen([Duel](int HitA) {
+      return Roll(4).Transform([Duel, HitA](int HitB) {
+        return FDuel{ std::max(0, Duel.A - HitB), std::max(0, Duel.B - HitA) };
+      });
+    });
+  };
+
+  TDist<double, FDuel> Sparse = Certainly(FDuel{ 10, 8 });
+  TTensorDist<double, FDuel> Dense = Sparse;
+  for (int i = 0; i < 6; ++i) {
+    Sparse = Sparse.AndThen(Round);
+    Dense = Dense.AndThen(Round);
+  }
+  ExpectSameDist(Dense.ToDist(), Sparse, 1e-15);
+
+  // Field updates and marginals work on the digits.
+  auto Heal = [](int HP) {
+    return Roll(2).Transform([HP](int x) { return std::min(8, HP + x); });
+  };
+  ExpectSameDist(Dense.UpdateField(1, Heal).ToDist(),
+                 Sparse.AndThen([&](const FDuel& Duel) {
+                   return UpdateFieldP(Duel, &FDuel::B, Heal(Duel.B));
+                 }),
+                 1e-15);
+  ExpectSameDist(Dense.Marginal(0).ToDist(),
+                 Sparse.Transform([](const FDuel& Duel) { return Duel.A; }),
+                 1e-15);
+
+  // Digits outside their radix throw rather than writing out of bounds.
+  EXPECT_THROW(TStateCodec<FDuel>::Encode({ 11, 0 }), std::out_of_range);
+  EXPECT_THROW(TStateCodec<FDuel>::Encode({ 0, -1 }), std::out_of_range);
+  EXPECT_THROW(Dense.AndThen([](const FDuel& Duel) {
+                 return Certainly(FDuel{ Duel.A, Duel.B + 9 });
+               }),
+               std::out_of_range);
+  EXPECT_THROW(Dense.UpdateField(1, [](int HP) { return Certainly(HP + 1); }),
+               std::out_of_range);
+  EXPECT_THROW(Dense.Marginal(2), std::out_of_range);
+
+  // Results that aren't tensor states fall back to `TDist<>`.
+  TDist<double, int> Total =
+      Dense.Transform([](const FDuel& Duel) { return Duel.A + Duel.B; });
+  EXPECT_NEAR(std::accumulate(Total.PDF.begin(), Total.PDF.end(), 0.0,
+                              [](double x, const auto& a) { return x + a.Prob; }),
+              1, 1e-12);
+}
+
+TEST(ChanceScript, test30) {
+  auto Dice = Product(Roll(6), Roll(4), Roll(2));
+  EXPECT_EQ(Dice.Factor<1>().PDF.size(), 4);
+
+  // The joint comes out canonical and matches building it directly.
+  auto Joint = Dice.Joint();
+  auto Expected = Roll(6).AndThen([](int x) {
+    return Roll(4).AndThen([x](int y) {
+      return Roll(2).Transform([x, y](int z) { return std::tuple{ x, y, z }; });
+    });
+  });
+  EXPECT_EQ(Joint.PDF.size(), 48);
+  ExpectSameDist(Joint, Expected, 1e-15);
+
+  // Transforming one factor leaves the others alone, and applying a
+  // continuation to two factors ignores the third.
+  auto Hit = Dice.Transform<1>([](int x) { return x >= 3; });
+  EXPECT_EQ(Hit.Factor<1>().PDF.size(), 2);
+  EXPECT_EQ(Hit.Factor<0>().PDF.size(), 6);
+  auto Damage = Hit.Apply<0, 1>(
+      [](int d, bool bHit) { return Certainly(bHit ? d : 0); });
+  ASSERT_EQ(Damage.PDF.size(), 7);
+  EXPECT_DOUBLE_EQ(Damage.PDF[0].Prob, 0.5);
+  EXPECT_DOUBLE_EQ(Damage.PDF[6].Prob, 1.0 / 12);
+
+  auto Pair = Dice.Project<2, 0>();
+  EXPECT_EQ(Pair.Joint().PDF.size(), 12);
+  EXPECT_EQ(std::get<0>(Pair.Joint().PDF.back().Value), 2);
+
+  // Lost probability combines as for independent events.
+  auto Lossy = Roll(4);
+  Lossy.Prune(FPruning{ 0, 2 });
+  auto Both = Product(Lossy, Lossy);
+  EXPECT_NEAR(Both.JointDiscarded(), 0.75, 1e-15);
+  EXPECT_NEAR(Both.Joint().Discarded, 0.75, 1e-15);
+  EXPECT_NEAR(Both.Apply<0>([](int x) { return Certainly(x); }).Discarded, 0.5, 1e-15);
+
+  // Combinations whose probability underflows are left out of the joint,
+  // as `Apply()` leaves them out.
+  TDist<double, int> Tiny{};
+  Tiny.PDF.push_back({ 0, 1e-200 });
+  Tiny.PDF.push_back({ 1, 1.0 });
+  auto Underflow = Product(Tiny, Tiny);
+  auto Pairs = Underflow.Apply<0, 1>(
+      [](int x, int y) { return Certainly(std::tuple{ x, y }); });
+  ExpectSameDist(Underflow.Joint(), Pairs, 0);
+  EXPECT_EQ(Underflow.Joint().PDF.size(), 3);
+}
+
+struct FPairState {
+  int A;
+  int B;
+  auto operator<=>(const FPairState&) const = default;
+};
+
+struct FSetState {
+  int A;
+  int B;
+  auto operator<=>(const FSetState&) const = default;
+  FSetState Canonicalise() const { return B < A ? FSetState{ B, A } : *this; }
+};
+
+template<> struct TStateCodec<FSetState> : TMixedRadix<7, 7> {
+  static FDigits ToDigits(const FSetState& State) { return { State.A, State.B }; }
+  static FSetState FromDigits(const FDigits& Digits) { return { Digits[0], Digits[1] }; }
+};
+
+TEST(ChanceScript, test31) {
+  static_assert(CSymmetric<FSetState>);
+  static_assert(!CSymmetric<FPairState>);
+
+  auto Step = []<typename StateType>(const StateType& State) {
+    return Roll(3).AndThen([State](int x) {
+      return Roll(3).Transform([State, x](int y) {
+        return StateType{ (State.A + x + 5) % 7, (State.B + y + 5) % 7 };
+      });
+    });
+  };
+
+  // Reducing after every step agrees with reducing once at the end, because
+  // each step treats both walkers alike up to relabelling.
+  auto Ordered = iterate(FPairState{ 3, 0 }, Step, 5);
+  auto Reduced = iterate(FSetState{ 3, 0 }, Step, 5);
+  EXPECT_EQ(Reduced.PDF.front().Value, (FSetState{ 0, 0 }));
+  auto Expected = Ordered.Transform([](const FPairState& State) {
+    return FSetState{ State.A, State.B }.Canonicalise();
+  });
+  EXPECT_LT(Reduced.PDF.size(), Ordered.PDF.size());
+  ExpectSameDist(Reduced, Expected, 1e-15);
+
+  TTensorDist<double, FSetState> Dense = Certainly(FSetState{ 3, 0 });
+  for (int i = 0; i < 5; ++i) {
+    Dense = Dense.AndThen(Step);
+    Dense.ReduceSymmetry();
+  }
+  ExpectSameDist(Dense.ToDist(), Expected, 1e-15);
+}
+
+struct FKeyedState {
+  int X;
+  int Y;
+  int Z;
+  auto operator<=>(const FKeyedState&) const = default;
+  auto GetSortKey() const { return PackSortKey(X, Y, Z); }
+};
+
+TEST(ChanceScript, test32) {
+  static_assert(CRadixSortable<FKeyedState>);
+  static_assert(CRadixSortable<int>);
+  static_assert(!CRadixSortable<FPairState>);
+  EXPECT_LT(PackSortKey(-1, 5), PackSortKey(0, -5));
+  EXPECT_LT(PackSortKey(2, -7, 3), PackSortKey(2, -6, -100));
+  // Unsigned fields keep their own order, including values of 2^31 and up.
+  EXPECT_LT(PackSortKey(0x7fffffffu, 0u), PackSortKey(0x80000000u, 0u));
+  EXPECT_LT(PackSortKey(std::uint8_t{ 1 }, -1), PackSortKey(std::uint8_t{ 200 }, -1));
+
+  // Enough atoms to take the radix path, with values in scrambled order.
+  TDist<double, FKeyedState> Keyed{};
+  TDist<double, int> Spread{};
+  for (int i = 0; i < 2000; ++i) {
+    const int j = (i * 7919) % 2000;
+    Keyed.PDF.push_back({ FKeyedState{ j % 7 - 3, -j, j / 13 }, 1.0 / 2000 });
+    Spread.PDF.push_back({ (j - 1000) * 100003, 1.0 / 2000 });
+  }
+  Keyed.PDF.push_back({ FKeyedState{ 0, -3, 0 }, 1.0 });
+  Keyed.canonicalise();
+  Spread.canonicalise();
+  ASSERT_EQ(Keyed.PDF.size(), 2000);
+  ASSERT_EQ(Spread.PDF.size(), 2000);
+  EXPECT_TRUE(std::is_sorted(Keyed.PDF.begin(), Keyed.PDF.end()));
+  EXPECT_TRUE(std::is_sorted(Spread.PDF.begin(), Spread.PDF.end()));
+  EXPECT_EQ(Spread.PDF.front().Value, -1000 * 100003);
+  EXPECT_DOUBLE_EQ(Keyed.PDF[std::lower_bound(Keyed.PDF.begin(), Keyed.PDF.end(),
+                                              TAtom<double, FKeyedState>{ { 0, -3, 0 }, 0 }) -
+                             Keyed.PDF.begin()].Prob,
+                   1.0 + 1.0 / 2000);
+}
+
+TEST(ChanceScript, test33) {
+  // `float` probabilities work end to end.
+  auto Step = [](int x) {
+    return Roll<float>(6).Transform([x](int y) { return std::max(0, x - y); });
+  };
+  auto Single = iterate<float>(100, Step, 20);
+  auto Double = iterate(100, [](int x) {
+    return Roll(6).Transform([x](int y) { return std::max(0, x - y); });
+  }, 20);
+  static_assert(std::same_as<decltype(Single), TDist<float, int>>);
+  ExpectSameDist(Single, Double, 1e-6);
+  auto Sum = Roll<float>(6) + Roll<float>(6);
+  EXPECT_FLOAT_EQ(Sum.PDF[5].Prob, 6.0f / 36);
+  auto Hit = Roll<float>(20) >= 15;
+  EXPECT_FLOAT_EQ(Hit.PDF[1].Prob, 0.3f);
+  auto Pairs = Roll<float>(4).AndThen([](int x) {
+    return Roll<float>(4).Transform([x](int y) { return std::pair{ x, y }; });
+  });
+  EXPECT_EQ(Pairs.PDF.size(), 16);
+
+  // Merging many small atoms into one keeps full `float` accuracy.
+  TDist<float, int> Many{};
+  for (int i = 0; i < 1000000; ++i) {
+    Many.PDF.push_back({ i % 3 == 0 ? 7 : 1000000, 1e-6f });
+  }
+  Many.Sort();
+  Many.Merge();
+  ASSERT_EQ(Many.PDF.size(), 2);
+  EXPECT_NEAR(Many.PDF[0].Prob, 333334e-6, 1e-7);
+  EXPECT_NEAR(Many.PDF[1].Prob, 666666e-6, 1e-7);
+
+  // So does every merge strategy of `AndThen()`.
+  TDist<float, int> Spread{};
+  for (int i = 0; i < 1000000; ++i) {
+    Spread.PDF.push_back({ i, 1e-6f });
+  }
+  auto Split = [](int x) { return Certainly<float>(x % 3 == 0 ? 0 : 1); };
+  for (auto Strategy : { EMergeStrategy::Sort, EMergeStrategy::Hash,
+                         EMergeStrategy::KWayMerge }) {
+    auto Merged = Spread.AndThen(Split, Strategy);
+    ASSERT_EQ(Merged.PDF.size(), 2);
+    EXPECT_NEAR(Merged.PDF[0].Prob, 333334e-6, 1e-7);
+    EXPECT_NEAR(Merged.PDF[1].Prob, 666666e-6, 1e-7);
+  }
+}
+
+TEST(ChanceScript, test34) {
+  // Exact probabilities for dice.
+  auto TwoD6 = Roll<FExactProb>(2, 6);
+  ASSERT_EQ(TwoD6.PDF.size(), 11);
+  EXPECT_EQ(TwoD6.PDF[5].Prob, FExactProb(1, 6));
+  EXPECT_EQ(TwoD6.PDF[0].Prob.ToString(), "1/36");
+  EXPECT_EQ(TwoD6.PDF[5].Prob.ToString(), "1/6");
+  EXPECT_FALSE(TwoD6.PDF[5].Prob.IsBig());
+
+  // Mixed denominators meet at their least common multiple.
+  EXPECT_EQ(FExactProb(1, 6) + FExactProb(1, 8), FExactProb(7, 24));
+  EXPECT_EQ((FExactProb(1, 6) + FExactProb(1, 8)).GetDenominator(),
+            FBigCount(24));
+  EXPECT_EQ(1 - FExactProb(1, 6), FExactProb(5, 6));
+  EXPECT_LT(FExactProb(1, 7), FExactProb(1, 6));
+  EXPECT_GT(FExactProb(1, 6), 0.16);
+
+  // 40d6 needs more than 64 bits, and still sums to exactly one.
+  auto Many = Roll<FExactProb>(40, 6);
+  ASSERT_EQ(Many.PDF.size(), 201);
+  FExactProb Total = 0;
+  for (const auto& [Value, Prob] : Many.PDF) {
+    Total += Prob;
+  }
+  EXPECT_TRUE(Many.PDF[100].Prob.IsBig());
+  EXPECT_EQ(Total, 1);
+  EXPECT_EQ(Many.PDF[0].Prob.ToString(), "1/13367494538843734067838845976576");
+  ExpectSameDist(ToDouble(Many), Roll(40, 6), 1e-15);
+
+  // Continuations that stop rolling keep exact results.
+  auto Step = [](int x) {
+    return x == 0 ? Certainly<FExactProb>(0)
+                  : Roll<FExactProb>(6).Transform(
+                        [x](int y) { return std::max(0, x - y); });
+  };
+  auto Hits = iterate<FExactProb>(5, Step, 3);
+  FExactProb Sum = 0;
+  for (const auto& [Value, Prob] : Hits.PDF) {
+    Sum += Prob;
+  }
+  EXPECT_EQ(Sum, 1);
+  EXPECT_EQ(Hits.PDF.back().Prob, FExactProb(1, 216));
+  auto HitsDouble = iterate(5, [](int x) {
+    return x == 0 ? Certainly(0)
+                  : Roll(6).Transform([x](int y) { return std::max(0, x - y); });
+  }, 3);
+  ExpectSameDist(Hits, HitsDouble, 1e-15);
+}
+
+TEST(ChanceScript, test35) {
+  // Thin tails are below the FFT's noise floor but are real probability, so
+  // they must survive addition.
+  TDDist<int> a{};
+  double Weight = 1;
+  for (int k = 0; k < 1000; ++k) {
+    a.PDF.push_back({ k, Weight });
+    Weight *= 0.9;
+  }
+  for (auto& Atom : a.PDF) Atom.Prob *= 0.1 / (1 - Weight);
+  auto Sum = a + a;
+  ASSERT_EQ(Sum.PDF.size(), 1999);
+  EXPECT_EQ(Sum.Discarded, 0);
+  EXPECT_DOUBLE_EQ(Sum.PDF.back().Prob, a.PDF.back().Prob * a.PDF.back().Prob);
+
+  // Flat inputs still take the FFT.
+  std::vector<double> Flat(2000, 1 / 2000.);
+  EXPECT_TRUE(ShouldConvolveWithFFT<double>(Flat.size(), Flat.size()));
+  EXPECT_TRUE(IsWithinFFTRange(Flat, Flat));
+  std::vector<double> Thin(a.PDF.size());
+  for (std::size_t i = 0; i < Thin.size(); ++i) Thin[i] = a.PDF[i].Prob;
+  EXPECT_FALSE(IsWithinFFTRange(Thin, Thin));
+}
+
+TEST(ChanceScript, test36) {
+  // `Roll(r, n)` keeps its whole support, however unlikely the extremes.
+  auto d = Roll(200, 6);
+  ASSERT_EQ(d.PDF.size(), 1001);
+  EXPECT_EQ(d.PDF.front().Value, 200);
+  EXPECT_EQ(d.PDF.back().Value, 1200);
+  EXPECT_EQ(d.Discarded, 0);
+  EXPECT_NEAR(d.PDF.front().Prob / std::pow(6.0, -200), 1, 1e-12);
+  double Total = 0;
+  for (const auto& [Value, Prob] : d.PDF) Total += Prob;
+  EXPECT_NEAR(Total, 1, 1e-12);
+}
+
+TEST(ChanceScript, test37) {
+  // Distributions a continuation keeps outside `iterate()` must not live in
+  // its step arena.
+  std::vector<TDDist<int>> Log;
+  auto Step = [&Log](int x) {
+    Log.push_back(Roll(200).Transform([x](int y) { return x + y; }));
+    TDDist<int> Copy = Log.back();
+    Log.push_back(Copy);
+    return Certainly(x + 1);
+  };
+  iterate(0, Step, 3);
+  ASSERT_EQ(Log.size(), 6);
+  for (std::size_t i = 0; i < Log.size(); ++i) {
+    EXPECT_EQ(Log[i].PDF.get_allocator().Resource, std::pmr::new_delete_resource());
+    ASSERT_EQ(Log[i].PDF.size(), 200);
+    EXPECT_EQ(Log[i].PDF[0].Value, static_cast<int>(i / 2) + 1);
+    EXPECT_DOUBLE_EQ(Log[i].PDF[199].Prob, 1 / 200.);
+  }
+
+  // Copies made inside an arena go to the heap too.
+  TDDist<int> Kept{};
+  {
+    FArenaScope Arena;
+    auto Temporary = Roll(300);
+    Kept = Temporary;
+    TDDist<int> Copy = Temporary;
+    EXPECT_EQ(Copy.PDF.get_allocator().Resource, std::pmr::new_delete_resource());
+  }
+  EXPECT_EQ(Kept.PDF.size(), 300);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();